@@ -2,7 +2,7 @@
 #include "../../LookAndFeel.h"
 
 AudioMeter::AudioMeter(
-    AudioMeterFifo<std::vector<float>> &inputOutputLevelFifo)
+    AudioMeterFifo<MeterLevels> &inputOutputLevelFifo)
     : inputOutputLevelFifo(inputOutputLevelFifo) {
   startTimerHz(60);
 }
@@ -25,7 +25,7 @@ void AudioMeter::paint(juce::Graphics &g) {
     }
 
     // Clip indicator
-    if (smoothedLevel[channel] > 0.99f) {
+    if (peakLevel[channel] > 0.99f) {
       g.setColour(juce::Colour(LookAndFeel::METER_RED));
     } else {
       g.setColour(juce::Colour(LookAndFeel::METER_OFF));
@@ -69,20 +69,30 @@ void AudioMeter::resized() {
 }
 
 void AudioMeter::timerCallback() {
-  std::vector<float> newLevel;
+  // Keep the loudest peak of every level still in the ring, so a clip in any
+  // recent block shows
+  std::array<float, 2> newPeak = {0.0f, 0.0f};
+  MeterLevels newLevel;
   while (inputOutputLevelFifo.pull(newLevel)) {
     rawLevel = newLevel;
+    for (int channel = 0; channel < 2; ++channel) {
+      newPeak[channel] = juce::jmax(newPeak[channel], newLevel.peak[channel]);
+    }
   }
 
   // Attack/release smoothing
   for (int channel = 0; channel < 2; ++channel) {
-    if (rawLevel[channel] > smoothedLevel[channel]) {
+    const auto rms = rawLevel.rms[channel];
+    if (rms > smoothedLevel[channel]) {
       smoothedLevel[channel] =
-          rawLevel[channel] * ATTACK + smoothedLevel[channel] * (1.0f - ATTACK);
+          rms * ATTACK + smoothedLevel[channel] * (1.0f - ATTACK);
     } else {
-      smoothedLevel[channel] = rawLevel[channel] * (1.0f - RELEASE) +
-                               smoothedLevel[channel] * RELEASE;
+      smoothedLevel[channel] =
+          rms * (1.0f - RELEASE) + smoothedLevel[channel] * RELEASE;
     }
+
+    peakLevel[channel] =
+        juce::jmax(newPeak[channel], peakLevel[channel] * RELEASE);
   }
 
   repaint();
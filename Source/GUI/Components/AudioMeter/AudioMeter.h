@@ -6,14 +6,15 @@
 
 class AudioMeter : public juce::Component, juce::Timer {
 public:
-  AudioMeter(AudioMeterFifo<std::vector<float>> &inputOutputLevelFifo);
+  AudioMeter(AudioMeterFifo<MeterLevels> &inputOutputLevelFifo);
   void paint(juce::Graphics &g) override;
   void resized() override;
 
 private:
-  AudioMeterFifo<std::vector<float>> &inputOutputLevelFifo;
-  std::vector<float> rawLevel = {0.0f, 0.0f};
-  std::vector<float> smoothedLevel = {0.0f, 0.0f};
+  AudioMeterFifo<MeterLevels> &inputOutputLevelFifo;
+  MeterLevels rawLevel;
+  std::array<float, 2> smoothedLevel = {0.0f, 0.0f};
+  std::array<float, 2> peakLevel = {0.0f, 0.0f};
 
   void timerCallback() override;
 
@@ -1,10 +1,12 @@
 #include "Input.h"
 
 Input::Input(juce::AudioProcessorValueTreeState &apvts,
-             AudioMeterFifo<std::vector<float>> &inputLevelFifo)
+             AudioMeterFifo<MeterLevels> &inputLevelFifo)
     : apvts(apvts), inputMeter(inputLevelFifo) {
   inputSlider =
       ParameterComponent::create(Parameters::Input::gain, apvts, this, false);
+  stereoModeBox =
+      ParameterComponent::create(Parameters::Stereo::mode, apvts, this);
   addAndMakeVisible(inputMeter);
 
   // Label
@@ -26,6 +28,9 @@ void Input::resized() {
   label.setBounds(bounds.removeFromTop(24));
   bounds.removeFromTop(4); // Gap
 
+  // Whether the effects run on left/right or mid/side
+  stereoModeBox->setBounds(bounds.removeFromTop(64));
+
   // Knob
   auto knobHeight = bounds.getHeight() * 0.35f;
   inputSlider->setBounds(bounds.removeFromBottom(knobHeight));
@@ -1,7 +1,6 @@
 #pragma once
 
 #include "../../../Utils/Fifos/AudioMeterFifo.h"
-#include "../../../Utils/Fifos/SpectrumAnalyzerFifo.h"
 #include "../../LookAndFeel.h"
 #include "../AudioMeter/AudioMeter.h"
 #include "../ParameterControls/ParameterComponent.h"
@@ -10,13 +9,14 @@
 class Input : public juce::Component {
 public:
   Input(juce::AudioProcessorValueTreeState &apvts,
-        AudioMeterFifo<std::vector<float>> &inputLevelFifo);
+        AudioMeterFifo<MeterLevels> &inputLevelFifo);
   void paint(juce::Graphics &g) override;
   void resized() override;
 
 private:
   juce::AudioProcessorValueTreeState &apvts;
   std::unique_ptr<ParameterComponent> inputSlider;
+  std::unique_ptr<ParameterComponent> stereoModeBox;
   AudioMeter inputMeter;
   juce::Label label;
 };
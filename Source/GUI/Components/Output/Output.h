@@ -9,7 +9,7 @@
 class Output : public juce::Component {
 public:
   Output(juce::AudioProcessorValueTreeState &apvts,
-         AudioMeterFifo<std::vector<float>> &outputLevelFifo);
+         AudioMeterFifo<MeterLevels> &outputLevelFifo);
   void paint(juce::Graphics &g) override;
   void resized() override;
 
@@ -0,0 +1,358 @@
+#include "ChainResponse.h"
+
+namespace {
+#if JUCE_USE_SIMD
+using Vector = juce::dsp::SIMDRegister<double>;
+#else
+using Vector = double;
+#endif
+
+constexpr size_t numLanes = sizeof(Vector) / sizeof(double);
+static_assert(ChainResponse::numPoints % numLanes == 0,
+              "The grid is walked a whole register at a time");
+
+constexpr double pi = juce::MathConstants<double>::pi;
+
+// Where the filters' prewarping stops, as in StateVariableFilter
+constexpr double maxNormalisedFrequency = 0.49;
+
+Vector expand(double value) {
+#if JUCE_USE_SIMD
+  return Vector::expand(value);
+#else
+  return value;
+#endif
+}
+
+Vector load(const double *source) {
+#if JUCE_USE_SIMD
+  return Vector::fromRawArray(source);
+#else
+  return *source;
+#endif
+}
+
+void store(Vector vector, double *dest) {
+#if JUCE_USE_SIMD
+  vector.copyToRawArray(dest);
+#else
+  *dest = vector;
+#endif
+}
+
+// COMPLEX LANES
+//==============================================================================
+// numLanes complex values, one per grid point
+struct Complex {
+  Vector re, im;
+};
+
+Complex operator+(Complex a, Complex b) { return {a.re + b.re, a.im + b.im}; }
+
+Complex operator+(Complex a, double b) { return {a.re + b, a.im}; }
+
+Complex operator*(Complex a, Complex b) {
+  return {a.re * b.re - a.im * b.im, a.re * b.im + a.im * b.re};
+}
+
+Complex operator*(Complex a, double b) { return {a.re * b, a.im * b}; }
+
+Complex getOne() { return {expand(1.0), expand(0.0)}; }
+
+template <typename Array> Complex loadPoints(const Array &array, size_t point) {
+  return {load(array.re.data() + point), load(array.im.data() + point)};
+}
+
+template <typename Array>
+void storePoints(Complex value, Array &array, size_t point) {
+  store(value.re, array.re.data() + point);
+  store(value.im, array.im.data() + point);
+}
+
+// EFFECT MODELS
+//==============================================================================
+// The chorus sweeps a delay and the drive is a waveshaper, neither has a
+// steady response of its own to draw
+bool isFlat(DspOption option) {
+  return option == DspOption::Chorus || option == DspOption::OverDrive;
+}
+
+// juce::dsp::LadderFilter mixes the input and its four stage outputs, and
+// compensates the input for the resonance's loss of level
+struct LadderMode {
+  std::array<double, 5> mix;
+  double compensation;
+};
+
+constexpr std::array<LadderMode, 6> ladderModes{{
+    {{0, 0, 1, 0, 0}, 0.5},   // LPF12
+    {{1, -2, 1, 0, 0}, 0.0},  // HPF12
+    {{0, 0, -1, 1, 0}, 0.5},  // BPF12
+    {{0, 0, 0, 0, 1}, 0.5},   // LPF24
+    {{1, -4, 6, -4, 1}, 0.0}, // HPF24
+    {{0, 0, 1, -2, 1}, 0.5},  // BPF24
+}};
+
+// The gain juce::dsp::LadderFilter puts after each of its tanh stages
+double getLadderMakeupGain(double drive) {
+  return std::pow(drive, -2.642) * 0.6103 + 0.3903;
+}
+} // namespace
+
+// CHAIN RESPONSE
+//==============================================================================
+ChainResponse::ChainResponse(double minFrequency, double maxFrequency) {
+  for (size_t point = 0; point < numPoints; ++point) {
+    frequencies[point] =
+        minFrequency * std::pow(maxFrequency / minFrequency,
+                                (double)point / (double)(numPoints - 1));
+  }
+
+  flat.numerator.re.fill(1.0);
+  flat.denominator.re.fill(1.0);
+}
+
+bool ChainResponse::update(const Parameters &parameters,
+                           const DspOrder &newOrder, double newSampleRate) {
+  // Until the host prepares the processor, the rate it most likely will
+  if (newSampleRate <= 0.0) {
+    newSampleRate = 44100.0;
+  }
+  if (newSampleRate != sampleRate) {
+    setSampleRate(newSampleRate);
+  }
+
+  const std::array<bool, numDspOptions> newBypassed = {
+      parameters.phaserBypass->get(), parameters.chorusBypass->get(),
+      parameters.overdriveBypass->get(), parameters.ladderFilterBypass->get(),
+      parameters.filterBypass->get()};
+
+  std::array<Settings, numDspOptions> settings{};
+  settings[static_cast<size_t>(DspOption::Phase)] = {
+      parameters.phaserCenterFreq->get(), parameters.phaserFeedback->get(),
+      parameters.phaserMix->get(), 0.0f};
+  settings[static_cast<size_t>(DspOption::LadderFilter)] = {
+      (float)parameters.ladderFilterMode->getIndex(),
+      parameters.ladderFilterCutoff->get(),
+      parameters.ladderFilterResonance->get(),
+      parameters.ladderFilterDrive->get()};
+  settings[static_cast<size_t>(DspOption::Filter)] = {
+      (float)parameters.filterMode->getIndex(), parameters.filterFreq->get(),
+      parameters.filterQuality->get(), parameters.filterGain->get()};
+
+  auto hasChanged = !isCombined || newOrder != order || newBypassed != bypassed;
+
+  // Only effects that are heard are evaluated, one that is brought back in
+  // catches up then
+  for (auto option : newOrder) {
+    const auto index = static_cast<size_t>(option);
+    auto &stage = stages[index];
+    if (isFlat(option) || newBypassed[index] ||
+        (stage.isValid && stage.settings == settings[index])) {
+      continue;
+    }
+
+    if (option == DspOption::Phase) {
+      evaluatePhaser(stage.response, settings[index]);
+    } else if (option == DspOption::LadderFilter) {
+      evaluateLadderFilter(stage.response, settings[index]);
+    } else {
+      evaluateFilter(stage.response, settings[index]);
+    }
+    stage.settings = settings[index];
+    stage.isValid = true;
+    hasChanged = true;
+  }
+
+  if (!hasChanged) {
+    return false;
+  }
+
+  order = newOrder;
+  bypassed = newBypassed;
+  combine();
+  isCombined = true;
+  return true;
+}
+
+void ChainResponse::setSampleRate(double newSampleRate) {
+  sampleRate = newSampleRate;
+
+  for (size_t point = 0; point < numPoints; ++point) {
+    const auto normalised =
+        juce::jmin(frequencies[point] / sampleRate, maxNormalisedFrequency);
+    unitDelay.re[point] = std::cos(2.0 * pi * normalised);
+    unitDelay.im[point] = -std::sin(2.0 * pi * normalised);
+    prewarped[point] = std::tan(pi * normalised);
+  }
+
+  for (auto &stage : stages) {
+    stage.isValid = false;
+  }
+  isCombined = false;
+}
+
+// STAGES
+//==============================================================================
+// juce::dsp::Phaser runs six first-order TPT all-passes, subtracts the last
+// one's output from its input and mixes the result with the dry signal. With
+// G = tan(pi fc / fs) each all-pass is (G - 1 + (G + 1) z^-1) over
+// (G + 1 + (G - 1) z^-1), and the LFO is taken at the centre of its sweep.
+// Settings: centre frequency, feedback, mix.
+void ChainResponse::evaluatePhaser(Response &response,
+                                   const Settings &settings) const {
+  const auto g = std::tan(
+      pi * juce::jmin(settings[0] / sampleRate, maxNormalisedFrequency));
+  const auto feedback = (double)settings[1];
+  const auto mix = (double)settings[2];
+
+  auto toTheSixth = [](Complex value) {
+    const auto squared = value * value;
+    return squared * squared * squared;
+  };
+
+  for (size_t point = 0; point < numPoints; point += numLanes) {
+    const auto z = loadPoints(unitDelay, point);
+    const auto allPasses = toTheSixth(z * (g + 1.0) + (g - 1.0));
+    const auto inverse = toTheSixth(z * (g - 1.0) + (g + 1.0));
+
+    // Wet: allPasses / (inverse + feedback z^-1 allPasses)
+    const auto denominator = inverse + z * allPasses * feedback;
+    storePoints(denominator * (1.0 - mix) + allPasses * mix,
+                response.numerator, point);
+    storePoints(denominator, response.denominator, point);
+  }
+}
+
+// juce::dsp::LadderFilter with its tanh stages taken as linear: four one-pole
+// stages (b0 + b1 z^-1) / (1 - a1 z^-1), the last one's output fed back
+// against the input through the resonance, and the mode's mix of the stage
+// outputs. Every stage shares the denominator, so stage k of the mix is
+// numerator^k denominator^(4 - k) over denominator^4.
+// Settings: mode, cutoff, resonance, drive.
+void ChainResponse::evaluateLadderFilter(Response &response,
+                                         const Settings &settings) const {
+  const auto &mode =
+      ladderModes[(size_t)juce::jlimit(0, 5, (int)settings[0])];
+  const auto a1 = std::exp(-2.0 * pi * settings[1] / sampleRate);
+  const auto b0 = (1.0 - a1) * 0.76923076923;
+  const auto b1 = (1.0 - a1) * 0.23076923076;
+  const auto resonance = juce::jmap((double)settings[2], 0.1, 1.0);
+  const auto drive = (double)settings[3];
+  const auto feedbackDrive = drive * 0.04 + 0.96;
+
+  const auto inputGain = getLadderMakeupGain(drive) * drive *
+                         (1.0 + 4.0 * resonance * mode.compensation);
+  const auto loopGain =
+      4.0 * resonance * getLadderMakeupGain(feedbackDrive) * feedbackDrive;
+
+  for (size_t point = 0; point < numPoints; point += numLanes) {
+    const auto z = loadPoints(unitDelay, point);
+
+    std::array<Complex, 5> numeratorPowers, denominatorPowers;
+    numeratorPowers[0] = denominatorPowers[0] = getOne();
+    for (size_t k = 1; k < 5; ++k) {
+      numeratorPowers[k] = numeratorPowers[k - 1] * (z * b1 + b0);
+      denominatorPowers[k] = denominatorPowers[k - 1] * (z * -a1 + 1.0);
+    }
+
+    Complex numerator{expand(0.0), expand(0.0)};
+    for (size_t k = 0; k < 5; ++k) {
+      if (mode.mix[k] != 0.0) {
+        numerator = numerator + numeratorPowers[k] *
+                                    denominatorPowers[4 - k] * mode.mix[k];
+      }
+    }
+
+    storePoints(numerator * inputGain, response.numerator, point);
+    storePoints(denominatorPowers[4] + z * numeratorPowers[4] * loopGain,
+                response.denominator, point);
+  }
+}
+
+// StateVariableFilter through the same prewarped bilinear transform as
+// Coefficients::getMagnitudeForFrequency, s = j tan(pi f / fs) / g, with both
+// sides scaled by g^2 to keep the division by g out of the loop.
+// Settings: mode, frequency, quality, gain.
+void ChainResponse::evaluateFilter(Response &response,
+                                   const Settings &settings) const {
+  const auto coefficients = StateVariableFilter<double>::Coefficients::make(
+      static_cast<FilterMode>((int)settings[0]), settings[2], settings[3]);
+  const auto cutoff = juce::jlimit(1.0, sampleRate * maxNormalisedFrequency,
+                                   (double)settings[1]);
+  const auto g = std::tan(pi * cutoff / sampleRate);
+
+  for (size_t point = 0; point < numPoints; point += numLanes) {
+    const auto t = load(prewarped.data() + point);
+
+    // m0 + (m1 s + m2) / (s^2 + k s + 1)
+    const Complex denominator{expand(g * g) - t * t,
+                              t * (coefficients.k * g)};
+    const Complex band{expand(coefficients.m2 * g * g),
+                       t * (coefficients.m1 * g)};
+    storePoints(denominator * coefficients.m0 + band, response.numerator,
+                point);
+    storePoints(denominator, response.denominator, point);
+  }
+}
+
+// COMBINING
+//==============================================================================
+// Sections multiply along the chain. Within one, each branch is added at its
+// gain over the common denominator: a / b + gain c / d = (a d + gain c b) / bd.
+void ChainResponse::combine() {
+  std::array<const Response *, maxChainLength> responses{};
+  for (size_t slot = 0; slot < order.size(); ++slot) {
+    const auto index = static_cast<size_t>(order[slot]);
+    responses[slot] = isFlat(order[slot]) || bypassed[index]
+                          ? &flat
+                          : &stages[index].response;
+  }
+
+  alignas(64) std::array<double, numLanes> numeratorPower, denominatorPower;
+
+  for (size_t point = 0; point < numPoints; point += numLanes) {
+    auto numerator = getOne();
+    auto denominator = getOne();
+
+    for (size_t first = 0; first < order.size();
+         first = order.getSectionEnd(first)) {
+      const auto end = order.getSectionEnd(first);
+      auto sectionNumerator = loadPoints(responses[first]->numerator, point);
+      auto sectionDenominator =
+          loadPoints(responses[first]->denominator, point);
+
+      // A lone slot is not a branch, its gain is not used
+      if (end - first > 1) {
+        sectionNumerator = sectionNumerator * order.getBranchGain(first);
+      }
+      for (auto slot = first + 1; slot < end; ++slot) {
+        const auto branchNumerator =
+            loadPoints(responses[slot]->numerator, point);
+        const auto branchDenominator =
+            loadPoints(responses[slot]->denominator, point);
+        sectionNumerator =
+            sectionNumerator * branchDenominator +
+            branchNumerator * sectionDenominator * order.getBranchGain(slot);
+        sectionDenominator = sectionDenominator * branchDenominator;
+      }
+
+      numerator = numerator * sectionNumerator;
+      denominator = denominator * sectionDenominator;
+    }
+
+    store(numerator.re * numerator.re + numerator.im * numerator.im,
+          numeratorPower.data());
+    store(denominator.re * denominator.re + denominator.im * denominator.im,
+          denominatorPower.data());
+
+    // The one division per point, an exact notch bottoms out instead of
+    // taking the log of zero
+    constexpr auto smallest = std::numeric_limits<double>::min();
+    for (size_t lane = 0; lane < numLanes; ++lane) {
+      decibels[point + lane] = static_cast<float>(
+          10.0 * (std::log10(juce::jmax(numeratorPower[lane], smallest)) -
+                  std::log10(juce::jmax(denominatorPower[lane], smallest))));
+    }
+  }
+}
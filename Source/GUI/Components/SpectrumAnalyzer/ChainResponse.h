@@ -0,0 +1,80 @@
+#pragma once
+
+#include "../../../Processor/DSP/DSP.h"
+#include <JuceHeader.h>
+
+// CHAIN RESPONSE
+//==============================================================================
+// The magnitude response of the whole effect chain, in the current order and
+// with bypassed effects passed straight through, on a grid of points spaced
+// evenly in log frequency.
+//
+// Each effect is modelled by its small-signal transfer function: the filter
+// exactly, the ladder with its saturation taken as linear and the phaser with
+// its LFO at the centre of the sweep. The chorus and the drive are drawn flat.
+//
+// An effect's response is only evaluated again when its own settings or the
+// sample rate change, every instance of an effect sharing it. Combining the
+// cached responses, multiplied along the chain and summed at their branch
+// gains within a section, is one more pass over the grid.
+//
+// Every pass runs numLanes points at a time on juce::dsp::SIMDRegister, which
+// has no division. Responses are therefore kept as a numerator over a
+// denominator, chained with products and sums alone, and each point is
+// divided once as a difference of logs when it is turned into dB.
+class ChainResponse {
+public:
+  static constexpr size_t numPoints = 256;
+
+  ChainResponse(double minFrequency, double maxFrequency);
+
+  // Returns true if the response changed since the last call
+  bool update(const Parameters &parameters, const DspOrder &order,
+              double sampleRate);
+
+  double getFrequency(size_t point) const { return frequencies[point]; }
+  float getDecibels(size_t point) const { return decibels[point]; }
+
+private:
+  // One complex value per grid point, the real and imaginary parts apart so
+  // a register loads a run of points at once
+  struct ComplexArray {
+    alignas(64) std::array<double, numPoints> re{};
+    alignas(64) std::array<double, numPoints> im{};
+  };
+
+  struct Response {
+    ComplexArray numerator, denominator;
+  };
+
+  // An effect's response and the settings it was evaluated for
+  using Settings = std::array<float, 4>;
+  struct Stage {
+    Response response;
+    Settings settings{};
+    bool isValid = false;
+  };
+
+  void setSampleRate(double newSampleRate);
+  void evaluatePhaser(Response &response, const Settings &settings) const;
+  void evaluateLadderFilter(Response &response,
+                            const Settings &settings) const;
+  void evaluateFilter(Response &response, const Settings &settings) const;
+  void combine();
+
+  std::array<double, numPoints> frequencies{};
+  double sampleRate = 0.0;
+
+  // z^-1 and tan(pi f / fs) at each grid point, for the current sample rate
+  ComplexArray unitDelay;
+  alignas(64) std::array<double, numPoints> prewarped{};
+
+  std::array<Stage, numDspOptions> stages; // Indexed by DspOption
+  Response flat;                           // The chorus, drive and bypass
+
+  DspOrder order;
+  std::array<bool, numDspOptions> bypassed{};
+  bool isCombined = false;
+
+  std::array<float, numPoints> decibels{};
+};
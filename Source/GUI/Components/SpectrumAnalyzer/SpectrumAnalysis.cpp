@@ -0,0 +1,57 @@
+#include "SpectrumAnalysis.h"
+
+SpectrumAnalysis::SpectrumAnalysis(SpectrumAnalyzerFifo<float> &fifo)
+    : juce::Thread("Spectrum Analysis"), analyzerFifo(fifo), fft(fftOrder),
+      window(fftSize, juce::dsp::WindowingFunction<float>::hann),
+      fftData(fftSize * 2, 0.0f),
+      frames(std::vector<float>(numBins, -100.0f)) {
+  // Start from whatever is in the ring now rather than from the beginning
+  readPosition = analyzerFifo.getWritePosition();
+  startThread(juce::Thread::Priority::low);
+}
+
+SpectrumAnalysis::~SpectrumAnalysis() {
+  // The thread may be asleep on the ring, waiting for audio that never comes
+  signalThreadShouldExit();
+  analyzerFifo.wakeReader();
+  stopThread(1000);
+}
+
+void SpectrumAnalysis::run() {
+  while (!threadShouldExit()) {
+    if (!analyseNextFrame()) {
+      analyzerFifo.waitForPosition(readPosition + fftSize);
+    }
+  }
+}
+
+bool SpectrumAnalysis::analyseNextFrame() {
+  constexpr auto frameSize = static_cast<juce::uint64>(fftSize);
+  constexpr auto hop = static_cast<juce::uint64>(hopSize);
+
+  const auto writePosition = analyzerFifo.getWritePosition();
+  if (readPosition + frameSize > writePosition) {
+    return false;
+  }
+
+  // Skip whole hops up to the newest complete frame
+  const auto newestStart = writePosition - frameSize;
+  readPosition += (newestStart - readPosition) / hop * hop;
+
+  if (!analyzerFifo.read(readPosition, fftData.data(), frameSize)) {
+    // Overwritten while we copied it, the next call skips ahead again
+    return true;
+  }
+  readPosition += hop;
+
+  window.multiplyWithWindowingTable(fftData.data(), fftSize);
+  fft.performFrequencyOnlyForwardTransform(fftData.data());
+
+  auto &frame = frames.getWriteBuffer();
+  for (size_t i = 0; i < frame.size(); ++i) {
+    float magnitude = fftData[i] * 12.0f / (float)fftSize;
+    frame[i] = juce::Decibels::gainToDecibels(magnitude, -100.0f);
+  }
+  frames.publish();
+  return true;
+}
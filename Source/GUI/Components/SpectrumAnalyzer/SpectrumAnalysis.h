@@ -0,0 +1,48 @@
+#pragma once
+
+#include "../../../Utils/Fifos/SpectrumAnalyzerFifo.h"
+#include "../../../Utils/Fifos/TripleBuffer.h"
+#include <JuceHeader.h>
+
+// SPECTRUM ANALYSIS
+//==============================================================================
+// Turns the processor's mono mix into magnitude spectra on a low priority
+// thread of its own, so the message thread only smooths and draws them.
+//
+// A frame of fftSize samples is read straight out of the analyzer ring every
+// hopSize samples, so consecutive frames overlap by 75%. If the thread falls
+// behind it skips to the newest frame, the only one that would be shown.
+// Between frames it sleeps until the ring wakes it with the next one, so it
+// costs nothing while the host is stopped. Finished frames, in dB per bin,
+// are handed over through a triple buffer.
+class SpectrumAnalysis : private juce::Thread {
+public:
+  static constexpr int fftOrder = 11; // 2^11 = 2048 samples
+  static constexpr int fftSize = 1 << fftOrder;
+  static constexpr int hopSize = fftSize / 4;
+  static constexpr int numBins = fftSize / 2;
+
+  explicit SpectrumAnalysis(SpectrumAnalyzerFifo<float> &analyzerFifo);
+  ~SpectrumAnalysis() override;
+
+  // MESSAGE THREAD
+  //============================================================================
+  // Takes the newest frame if one was finished since the last call
+  bool pullFrame() { return frames.update(); }
+  const std::vector<float> &getFrame() const { return frames.getReadBuffer(); }
+
+private:
+  void run() override;
+
+  // Returns false if no new frame has been written yet
+  bool analyseNextFrame();
+
+  SpectrumAnalyzerFifo<float> &analyzerFifo;
+  juce::uint64 readPosition = 0; // First sample of the next frame
+
+  juce::dsp::FFT fft;
+  juce::dsp::WindowingFunction<float> window;
+  std::vector<float> fftData; // Input to FFT (size = fftSize * 2)
+
+  TripleBuffer<std::vector<float>> frames;
+};
@@ -3,53 +3,105 @@
 #include "../../LookAndFeel.h"
 
 SpectrumAnalyzer::SpectrumAnalyzer(PluginProcessor &audioProcessor)
-    : audioProcessor(audioProcessor), fft(fftOrder),
-      window(fftSize, juce::dsp::WindowingFunction<float>::hann),
-      analyzerFifo(audioProcessor.analyzerFifo) {
-  fifoBuffer.resize(fftSize, 0.0f);
-  fftData.resize(fftSize * 2, 0.0f);
-  scopeData.resize(fftSize / 2, 0.0f);
-  smoothedData.resize(fftSize / 2, -100.0f);
+    : audioProcessor(audioProcessor), analysis(audioProcessor.analyzerFifo) {
+  smoothedData.resize(SpectrumAnalysis::numBins, -100.0f);
+  audioProcessor.parameters.apvts.state.addListener(this);
   startTimerHz(60);
 };
 
+SpectrumAnalyzer::~SpectrumAnalyzer() {
+  audioProcessor.parameters.apvts.state.removeListener(this);
+}
+
 void SpectrumAnalyzer::paint(juce::Graphics &g) {
   auto bounds = getLocalBounds();
   LookAndFeel::drawBorder(g, getLookAndFeel(), bounds);
 
+  // The host can change the sample rate while the editor is open
+  if (audioProcessor.getSampleRate() != columnsSampleRate) {
+    updateColumns();
+  }
+
   SpectrumAnalyzer::drawSpectrum(g, bounds);
   SpectrumAnalyzer::drawFilterCurve(g, bounds);
+  SpectrumAnalyzer::drawChainCurve(g, bounds);
   SpectrumAnalyzer::drawFrequencyMarkers(g, bounds);
 }
 
-void SpectrumAnalyzer::resized() { repaint(); };
-
-void SpectrumAnalyzer::drawFilterCurve(juce::Graphics &g,
-                                       juce::Rectangle<int> bounds) {
-
-  auto sampleRate = audioProcessor.getSampleRate();
-  auto coefficients = audioProcessor.dsp.getFilterCoefficients();
-  auto isBypassed = audioProcessor.parameters.filterBypass->get();
+void SpectrumAnalyzer::resized() {
+  updateColumns();
+  repaint();
+};
 
-  juce::Path responseCurve;
-  float width = bounds.getWidth();
-  auto height = bounds.getHeight();
+void SpectrumAnalyzer::updateColumns() {
+  const auto width = getLocalBounds().getWidth();
+  const auto numBins = static_cast<int>(smoothedData.size());
+  columnsSampleRate = audioProcessor.getSampleRate();
+  auto freqBinWidth = columnsSampleRate / (float)fftSize;
 
+  columns.resize(static_cast<size_t>(juce::jmax(0, width)));
   for (int x = 0; x < width; ++x) {
-    auto normalizedX = x / width;
-    auto currentFreq = MIN_FREQ * std::pow(MAX_FREQ / MIN_FREQ, normalizedX);
+    auto &column = columns[static_cast<size_t>(x)];
+    auto normalizedX = (float)x / width;
+    column.frequency = MIN_FREQ * std::pow(MAX_FREQ / MIN_FREQ, normalizedX);
 
-    auto magnitude =
-        coefficients->getMagnitudeForFrequency(currentFreq, sampleRate);
-    float magnitudeDb = juce::Decibels::gainToDecibels(magnitude);
+    // Columns are spaced evenly in log frequency, so the tilt, linear in log
+    // frequency, is linear in x
+    column.tilt = normalizedX * TILT;
 
-    auto normalizedY = juce::jmap(magnitudeDb, MIN_DB, MAX_DB, 1.0f, 0.0f);
-    auto y = bounds.getY() + normalizedY * height;
+    // Blend magnitude between adjacent bins for smoother display
+    column.lowerBin = column.upperBin = -1;
+    column.upperWeight = 0.0f;
+    if (freqBinWidth <= 0.0) {
+      continue;
+    }
+    auto targetBin = static_cast<float>(column.frequency / freqBinWidth);
+    auto lowerBin = (int)targetBin;
+    if (lowerBin < numBins - 1) {
+      column.lowerBin = lowerBin;
+      column.upperBin = lowerBin + 1;
+      column.upperWeight = targetBin - lowerBin;
+    } else if (lowerBin < numBins) {
+      column.lowerBin = column.upperBin = lowerBin;
+    }
+  }
+}
 
-    if (x == 0) {
-      responseCurve.startNewSubPath(x, y);
-    } else {
-      responseCurve.lineTo(x, y);
+void SpectrumAnalyzer::drawFilterCurve(juce::Graphics &g,
+                                       juce::Rectangle<int> bounds) {
+
+  // Computed from the parameters rather than read back from the audio
+  // thread's filter, which keeps its coefficients to itself
+  const auto &parameters = audioProcessor.parameters;
+  const FilterCurveKey key{parameters.filterMode->getIndex(),
+                           parameters.filterFreq->get(),
+                           parameters.filterQuality->get(),
+                           parameters.filterGain->get(),
+                           columnsSampleRate,
+                           bounds};
+  auto isBypassed = parameters.filterBypass->get();
+
+  if (key != filterCurveKey) {
+    filterCurveKey = key;
+    auto coefficients = StateVariableFilter<double>::Coefficients::make(
+        static_cast<FilterMode>(key.mode), key.quality, key.gain);
+    auto height = bounds.getHeight();
+
+    filterCurve.clear();
+    for (size_t x = 0; x < columns.size(); ++x) {
+      auto magnitude = coefficients.getMagnitudeForFrequency(
+          columns[x].frequency, key.freq, key.sampleRate);
+      float magnitudeDb =
+          juce::Decibels::gainToDecibels(static_cast<float>(magnitude));
+
+      auto normalizedY = juce::jmap(magnitudeDb, MIN_DB, MAX_DB, 1.0f, 0.0f);
+      auto y = bounds.getY() + normalizedY * height;
+
+      if (x == 0) {
+        filterCurve.startNewSubPath((float)x, y);
+      } else {
+        filterCurve.lineTo((float)x, y);
+      }
     }
   }
 
@@ -58,32 +110,69 @@ void SpectrumAnalyzer::drawFilterCurve(juce::Graphics &g,
   auto color =
       isBypassed ? LookAndFeel::getBypassedColour(activeColor) : activeColor;
   g.setColour(color);
-  g.strokePath(responseCurve, juce::PathStrokeType(2.0f));
+  g.strokePath(filterCurve, juce::PathStrokeType(2.0f));
 };
 
-void SpectrumAnalyzer::timerCallback() {
-  // Drain FIFO and accumulate samples into fifoBuffer
-  while (analyzerFifo.pull(analyzerSamples)) {
-    for (float sample : analyzerSamples) {
-      fifoBuffer[currentFifoIndex] = sample;
-
-      // Once Buffer is full, perform FFT
-      if (currentFifoIndex + 1 == fftSize) {
-        std::copy(fifoBuffer.begin(), fifoBuffer.end(), fftData.begin());
-        window.multiplyWithWindowingTable(fftData.data(), fftSize);
-        fft.performFrequencyOnlyForwardTransform(fftData.data());
-
-        for (int i = 0; i < scopeData.size(); ++i) {
-          float magnitude = fftData[i] * 12.0f / (float)fftSize;
-          scopeData[i] = juce::Decibels::gainToDecibels(magnitude, -100.0f);
-        }
-        currentFifoIndex = 0;
+void SpectrumAnalyzer::drawChainCurve(juce::Graphics &g,
+                                      juce::Rectangle<int> bounds) {
+  // The grid spans the display in log frequency, so its points are evenly
+  // spaced across the width
+  if (bounds != chainCurveBounds) {
+    chainCurveBounds = bounds;
+    auto lastPoint = static_cast<float>(ChainResponse::numPoints - 1);
+
+    chainCurve.clear();
+    for (size_t point = 0; point < ChainResponse::numPoints; ++point) {
+      auto x = (float)point / lastPoint * (float)bounds.getWidth();
+      auto normalizedY = juce::jmap(chainResponse.getDecibels(point), MIN_DB,
+                                    MAX_DB, 1.0f, 0.0f);
+      auto y = bounds.getY() + normalizedY * bounds.getHeight();
+
+      if (point == 0) {
+        chainCurve.startNewSubPath(x, y);
       } else {
-        currentFifoIndex++;
+        chainCurve.lineTo(x, y);
       }
     }
   }
 
+  g.setColour(juce::Colour(LookAndFeel::TEXT).withAlpha(0.8f));
+  g.strokePath(chainCurve, juce::PathStrokeType(1.5f));
+}
+
+// Any thread the host restores the state on
+void SpectrumAnalyzer::valueTreePropertyChanged(juce::ValueTree &tree,
+                                                const juce::Identifier &) {
+  if (tree.hasType("DspOrder")) {
+    chainOrderChanged = true;
+  }
+}
+
+void SpectrumAnalyzer::valueTreeChildAdded(juce::ValueTree &,
+                                           juce::ValueTree &child) {
+  if (child.hasType("DspOrder")) {
+    chainOrderChanged = true;
+  }
+}
+
+void SpectrumAnalyzer::valueTreeRedirected(juce::ValueTree &) {
+  chainOrderChanged = true;
+}
+
+void SpectrumAnalyzer::timerCallback() {
+  if (chainOrderChanged.exchange(false)) {
+    chainOrder = audioProcessor.getDspOrderFromState();
+  }
+
+  // Only the effects whose settings moved are evaluated again
+  if (chainResponse.update(audioProcessor.parameters, chainOrder,
+                           audioProcessor.getSampleRate())) {
+    chainCurveBounds.reset();
+  }
+
+  analysis.pullFrame();
+  const auto &scopeData = analysis.getFrame();
+
   // Attack/release smoothing
   for (int i = 0; i < scopeData.size(); ++i) {
     if (scopeData[i] > smoothedData[i]) {
@@ -100,46 +189,27 @@ void SpectrumAnalyzer::timerCallback() {
 
 void SpectrumAnalyzer::drawSpectrum(juce::Graphics &g,
                                     juce::Rectangle<int> bounds) {
-  auto width = bounds.getWidth();
-  auto height = bounds.getHeight();
-  auto sampleRate = audioProcessor.getSampleRate();
-  auto freqBinWidth = sampleRate / (float)fftSize;
+  // Cleared rather than rebuilt, so it keeps its storage between frames
+  spectrumPath.clear();
 
-  juce::Path spectrumPath;
+  for (size_t x = 0; x < columns.size(); ++x) {
+    const auto &column = columns[x];
 
-  for (int x = 0; x < width; ++x) {
-    // Map frequency to x position
-    auto normalizedX = (float)x / width;
-    auto freq = MIN_FREQ * std::pow(MAX_FREQ / MIN_FREQ, normalizedX);
-
-    // Map frequency to FFT bin
-    float targetBin = freq / freqBinWidth;
-    int lowerBin = (int)targetBin;
-    float binOffset = targetBin - lowerBin;
-
-    // Blend magnitude between adjacent bins for smoother display
     float magnitude = MIN_DB;
-    if (lowerBin >= 0 && lowerBin < smoothedData.size() - 1) {
-      magnitude = juce::jmap(binOffset, smoothedData[lowerBin],
-                             smoothedData[lowerBin + 1]);
-    } else if (lowerBin >= 0 && lowerBin < smoothedData.size()) {
-      magnitude = smoothedData[lowerBin];
+    if (column.lowerBin >= 0) {
+      magnitude = juce::jmap(column.upperWeight, smoothedData[column.lowerBin],
+                             smoothedData[column.upperBin]);
     }
-
-    // Apply frequency tilt
-    float freqNormalized = juce::jmap(std::log10(freq), std::log10(MIN_FREQ),
-                                      std::log10(MAX_FREQ), 0.0f, 1.0f);
-    float tiltCompensation = freqNormalized * TILT;
-    magnitude += tiltCompensation;
+    magnitude += column.tilt;
 
     // Map magnitude to y position
     auto level = juce::jmap(magnitude, MIN_DB, MAX_DB,
                             (float)bounds.getBottom(), (float)bounds.getY());
 
     if (x == 0)
-      spectrumPath.startNewSubPath(x, level);
+      spectrumPath.startNewSubPath((float)x, level);
     else
-      spectrumPath.lineTo(x, level);
+      spectrumPath.lineTo((float)x, level);
   }
 
   g.setColour(juce::Colour(LookAndFeel::TEXT).withAlpha(0.5f));
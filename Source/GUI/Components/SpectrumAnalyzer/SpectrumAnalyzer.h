@@ -1,13 +1,17 @@
 #pragma once
 
-#include "../../../Utils/Fifos/SpectrumAnalyzerFifo.h"
+#include "ChainResponse.h"
+#include "SpectrumAnalysis.h"
 #include <JuceHeader.h>
 class PluginProcessor;
 
-class SpectrumAnalyzer : public juce::Component, public juce::Timer {
+class SpectrumAnalyzer : public juce::Component,
+                         public juce::Timer,
+                         private juce::ValueTree::Listener {
 
 public:
   SpectrumAnalyzer(PluginProcessor &p);
+  ~SpectrumAnalyzer() override;
 
   void resized() override;
   void paint(juce::Graphics &g) override;
@@ -24,25 +28,69 @@ private:
       {50.0f, "50"},   {100.0f, "100"}, {250.0f, "250"}, {500.0f, "500"},
       {1000.0f, "1k"}, {2000.0f, "2k"}, {4000.0f, "4k"}, {10000.0f, "10k"}};
 
-  juce::dsp::FFT fft;
-  juce::dsp::WindowingFunction<float> window;
-  static constexpr int fftOrder = 11; // 2^11 = 2048 samples
-  static constexpr int fftSize = 1 << fftOrder;
+  static constexpr int fftSize = SpectrumAnalysis::fftSize;
 
-  int currentFifoIndex = 0;
-  std::vector<float> fifoBuffer;   // Accumulates incoming samples
-  std::vector<float> fftData;      // Input to FFT (size = fftSize * 2)
-  std::vector<float> scopeData;    // Processed FFT magnitudes for display
+  // The FFT runs on the analysis thread, the timer only smooths its newest
+  // frame towards the display
+  SpectrumAnalysis analysis;
   std::vector<float> smoothedData; // Smoothed spectrum with attack/release
 
   static constexpr float ATTACK = 0.2f;
   static constexpr float RELEASE = 0.95f;
   static constexpr float TILT = 30.0f; // 3db per octave
 
-  SpectrumAnalyzerFifo<std::vector<float>> &analyzerFifo;
-  std::vector<float> analyzerSamples;
+  // PIXEL COLUMNS
+  //============================================================================
+  // What each pixel column of the display shows, rebuilt when the width or
+  // the sample rate changes so painting needs no pow or log10
+  struct Column {
+    float frequency = 0.0f;
+    int lowerBin = -1; // -1 if the frequency is past the last bin
+    int upperBin = -1;
+    float upperWeight = 0.0f; // Blend towards upperBin
+    float tilt = 0.0f;        // dB added to the spectrum here
+  };
+
+  std::vector<Column> columns;
+  double columnsSampleRate = 0.0;
+  juce::Path spectrumPath;
+  void updateColumns();
+
+  // FILTER CURVE
+  //============================================================================
+  // The response path only changes with the filter's parameters, the sample
+  // rate or the size, so it is kept until one of them does
+  struct FilterCurveKey {
+    int mode = 0;
+    float freq = 0.0f, quality = 0.0f, gain = 0.0f;
+    double sampleRate = 0.0;
+    juce::Rectangle<int> bounds;
+
+    bool operator==(const FilterCurveKey &) const = default;
+  };
+
+  juce::Path filterCurve;
+  std::optional<FilterCurveKey> filterCurveKey;
+
+  // CHAIN CURVE
+  //============================================================================
+  // The response of the whole chain, drawn over the filter's. The order is
+  // read back from the state only after the state reports a change to it.
+  ChainResponse chainResponse{MIN_FREQ, MAX_FREQ};
+  DspOrder chainOrder;
+  std::atomic<bool> chainOrderChanged{true};
+
+  juce::Path chainCurve;
+  std::optional<juce::Rectangle<int>> chainCurveBounds;
+
+  void valueTreePropertyChanged(juce::ValueTree &tree,
+                                const juce::Identifier &property) override;
+  void valueTreeChildAdded(juce::ValueTree &parent,
+                           juce::ValueTree &child) override;
+  void valueTreeRedirected(juce::ValueTree &tree) override;
 
   void timerCallback() override;
+  void drawChainCurve(juce::Graphics &g, juce::Rectangle<int> bounds);
   void drawFilterCurve(juce::Graphics &g, juce::Rectangle<int> bounds);
   void drawSpectrum(juce::Graphics &g, juce::Rectangle<int> bounds);
   void drawFrequencyMarkers(juce::Graphics &g, juce::Rectangle<int> bounds);
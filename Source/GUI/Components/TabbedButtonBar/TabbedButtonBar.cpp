@@ -1,5 +1,6 @@
 #include "TabbedButtonBar.h"
 #include "../../../Processor/PluginProcessor/PluginProcessor.h"
+#include "../../LookAndFeel.h"
 #include "PowerButton.h"
 
 // HORIZONTAL CONSTRAINER
@@ -53,6 +54,13 @@ ExtendedTabBarButton::ExtendedTabBarButton(
 }
 
 void ExtendedTabBarButton::mouseDown(const juce::MouseEvent &e) {
+  if (e.mods.isPopupMenu()) {
+    if (listener) {
+      listener->tabMenuRequested(this);
+    }
+    return;
+  }
+
   toFront(true);
   dragger.startDraggingComponent(this, e);
   if (listener) {
@@ -62,6 +70,10 @@ void ExtendedTabBarButton::mouseDown(const juce::MouseEvent &e) {
 }
 
 void ExtendedTabBarButton::mouseDrag(const juce::MouseEvent &e) {
+  if (e.mods.isPopupMenu()) {
+    return;
+  }
+
   toFront(true);
   dragger.dragComponent(this, e, constrainer.get());
   if (listener) {
@@ -70,12 +82,22 @@ void ExtendedTabBarButton::mouseDrag(const juce::MouseEvent &e) {
 }
 
 void ExtendedTabBarButton::mouseUp(const juce::MouseEvent &e) {
+  if (e.mods.isPopupMenu()) {
+    return;
+  }
+
   if (listener) {
     listener->tabDragEnded(this);
   }
   juce::TabBarButton::mouseUp(e);
 }
 
+void ExtendedTabBarButton::setParallel(bool shouldBeParallel) {
+  parallel = shouldBeParallel;
+  getProperties().set(LookAndFeel::parallelProperty, parallel);
+  repaint();
+}
+
 int ExtendedTabBarButton::getBestTabLength(int depth) {
   auto bestWidth = getLookAndFeel().getTabButtonBestWidth(*this, depth);
   auto &bar = getTabbedButtonBar();
@@ -97,6 +119,17 @@ void ExtendedTabbedButtonBar::addTab(DspOption option, int insertIndex) {
       insertIndex);
 }
 
+void ExtendedTabbedButtonBar::setDspOrder(const DspOrder &dspOrder) {
+  clearTabs();
+  for (size_t i = 0; i < dspOrder.size(); ++i) {
+    addTab(dspOrder[i]);
+    auto *tab = static_cast<ExtendedTabBarButton *>(getTabButton(
+        static_cast<int>(i)));
+    tab->setParallel(dspOrder.isParallel(i));
+    tab->branchGain = dspOrder.getBranchGain(i);
+  }
+}
+
 juce::TabBarButton *
 ExtendedTabbedButtonBar::createTabButton(const juce::String &tabName,
                                          int tabIndex) {
@@ -110,14 +143,7 @@ ExtendedTabbedButtonBar::createTabButton(const juce::String &tabName,
 void ExtendedTabbedButtonBar::tabDragStarted(ExtendedTabBarButton *button) {}
 
 void ExtendedTabbedButtonBar::tabDragMoved(ExtendedTabBarButton *button) {
-  int draggedTabIndex = -1;
-  for (int i = 0; i < getNumTabs(); ++i) {
-    if (getTabButton(i) == button) {
-      draggedTabIndex = i;
-      break;
-    }
-  }
-
+  int draggedTabIndex = getTabIndex(button);
   if (draggedTabIndex == -1)
     return;
 
@@ -146,13 +172,95 @@ void ExtendedTabbedButtonBar::tabDragMoved(ExtendedTabBarButton *button) {
 
 void ExtendedTabbedButtonBar::tabDragEnded(ExtendedTabBarButton *button) {
   resized();
+  notifyTabOrderChanged();
+}
+
+void ExtendedTabbedButtonBar::tabMenuRequested(ExtendedTabBarButton *button) {
+  const auto tabIndex = getTabIndex(button);
+  if (tabIndex == -1)
+    return;
 
-  DspOrder newDspOrder;
+  const auto dspOrder = getDspOrder();
+  juce::PopupMenu addMenu;
+  for (size_t i = 0; i < numDspOptions; ++i) {
+    auto option = static_cast<DspOption>(i);
+    addMenu.addItem(PluginProcessor::getDspNameFromOption(option),
+                    dspOrder.canAdd(option), false, [this, tabIndex, option] {
+                      addTab(option, tabIndex + 1);
+                      setCurrentTabIndex(tabIndex + 1);
+                      notifyTabOrderChanged();
+                    });
+  }
+
+  // A branch's gain only counts while it is part of a parallel section
+  juce::Component::SafePointer<ExtendedTabBarButton> tab(button);
+  const auto index = static_cast<size_t>(tabIndex);
+  const auto inSection =
+      dspOrder.isParallel(index) ||
+      (index + 1 < dspOrder.size() && dspOrder.isParallel(index + 1));
+  juce::PopupMenu gainMenu;
+  for (auto decibels : {0.f, -3.f, -6.f, -12.f}) {
+    const auto gain = juce::Decibels::decibelsToGain(decibels);
+    gainMenu.addItem(juce::String(decibels, 0) + " dB", true,
+                     std::abs(button->branchGain - gain) < 0.001f,
+                     [this, tab, gain] {
+                       if (tab != nullptr) {
+                         tab->branchGain = gain;
+                         notifyTabOrderChanged();
+                       }
+                     });
+  }
+
+  juce::PopupMenu menu;
+  menu.addSubMenu("Add After", addMenu, dspOrder.size() < maxChainLength);
+  menu.addItem("Remove", getNumTabs() > 1, false, [this, tabIndex] {
+    removeTab(tabIndex);
+    notifyTabOrderChanged();
+  });
+  menu.addSeparator();
+  menu.addItem("Parallel With Previous", tabIndex > 0, button->parallel,
+               [this, tab] {
+                 if (tab != nullptr) {
+                   tab->setParallel(!tab->parallel);
+                   notifyTabOrderChanged();
+                 }
+               });
+  menu.addSubMenu("Branch Gain", gainMenu, inSection);
+  menu.showMenuAsync(juce::PopupMenu::Options().withTargetComponent(button));
+}
+
+int ExtendedTabbedButtonBar::getTabIndex(
+    const juce::TabBarButton *button) const {
+  for (int i = 0; i < getNumTabs(); ++i) {
+    if (getTabButton(i) == button) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+DspOrder ExtendedTabbedButtonBar::getDspOrder() const {
+  DspOrder dspOrder;
   for (int i = 0; i < getNumTabs(); i++) {
     auto *tab = static_cast<ExtendedTabBarButton *>(getTabButton(i));
-    newDspOrder[i] = tab->dspOption;
+    const auto index = dspOrder.size();
+    if (dspOrder.add(tab->dspOption)) {
+      dspOrder.setParallel(index, tab->parallel);
+      dspOrder.setBranchGain(index, tab->branchGain);
+    }
+  }
+  return dspOrder;
+}
+
+void ExtendedTabbedButtonBar::notifyTabOrderChanged() {
+  auto dspOrder = getDspOrder();
+
+  // The first tab can't run in parallel, whatever was dragged there
+  for (int i = 0; i < getNumTabs(); ++i) {
+    auto *tab = static_cast<ExtendedTabBarButton *>(getTabButton(i));
+    tab->setParallel(dspOrder.isParallel(static_cast<size_t>(i)));
   }
-  tabOrderListener.call(&TabOrderListener::tabOrderChanged, newDspOrder);
+  tabOrderListener.call(&TabOrderListener::tabOrderChanged, dspOrder);
 }
 
 void ExtendedTabbedButtonBar::currentTabChanged(int newSelectionIndex,
@@ -169,7 +277,21 @@ void ExtendedTabbedButtonBar::currentTabChanged(int newSelectionIndex,
 
   auto *button =
       static_cast<ExtendedTabBarButton *>(getTabButton(newSelectionIndex));
+  if (button == nullptr)
+    return; // Tabs cleared
+
   auto dspOption = button->dspOption;
   tabSelectionListener.call(&TabSelectionListener::tabSelectionChanged,
                             newSelectionIndex, dspOption);
 }
+
+void ExtendedTabbedButtonBar::setCpuLoads(
+    const std::array<double, static_cast<size_t>(DspOption::END_OF_LIST)>
+        &loads) {
+  for (int i = 0; i < getNumTabs(); ++i) {
+    auto *button = static_cast<ExtendedTabBarButton *>(getTabButton(i));
+    auto load = loads[static_cast<size_t>(button->dspOption)];
+    button->getProperties().set(LookAndFeel::cpuLoadProperty, load);
+    button->repaint();
+  }
+}
@@ -56,8 +56,11 @@ struct ExtendedTabBarButton : juce::TabBarButton {
   int getBestTabLength(int depth) override;
 
   void setButtonEventListener(TabButtonEventListener *l) { listener = l; }
+  void setParallel(bool shouldBeParallel);
 
   DspOption dspOption;
+  bool parallel = false;
+  float branchGain = 1.f;
 
 private:
   juce::ComponentDragger dragger;
@@ -75,6 +78,9 @@ struct ExtendedTabbedButtonBar : juce::TabbedButtonBar, TabButtonEventListener {
 
   void addTab(DspOption option, int insertIndex = -1);
 
+  // Replaces every tab with the slots of the order
+  void setDspOrder(const DspOrder &dspOrder);
+
   juce::TabBarButton *createTabButton(const juce::String &tabName,
                                       int tabIndex) override;
 
@@ -94,10 +100,22 @@ struct ExtendedTabbedButtonBar : juce::TabbedButtonBar, TabButtonEventListener {
   void tabDragMoved(ExtendedTabBarButton *button) override;
   void tabDragEnded(ExtendedTabBarButton *button) override;
 
+  // Right click: add an effect after the tab, repeats included, remove it, or
+  // run it in parallel with the tab before it
+  void tabMenuRequested(ExtendedTabBarButton *button) override;
+
   void currentTabChanged(int newSelectionIndex,
                          const juce::String &dspName) override;
 
+  // Per-slot CPU load (fraction of the block duration) shown on each tab
+  void setCpuLoads(const std::array<double, static_cast<size_t>(
+                                                DspOption::END_OF_LIST)> &loads);
+
 private:
+  int getTabIndex(const juce::TabBarButton *button) const;
+  DspOrder getDspOrder() const;
+  void notifyTabOrderChanged();
+
   juce::ListenerList<TabOrderListener> tabOrderListener;
   juce::ListenerList<TabSelectionListener> tabSelectionListener;
   juce::AudioProcessorValueTreeState &apvts;
@@ -14,6 +14,17 @@ public:
   static constexpr juce::uint32 METER_OFF =
       0xff141418; // Dimmed background for meter segments
 
+  // Tab button property holding the slot's CPU load as a fraction
+  static inline const juce::Identifier cpuLoadProperty{"cpuLoad"};
+
+  // Tab button property set while the slot runs in parallel with the one
+  // before it
+  static inline const juce::Identifier parallelProperty{"parallel"};
+
+  static juce::String formatCpuLoad(double load) {
+    return juce::String(load * 100.0, 1) + "%";
+  }
+
   LookAndFeel() {
     auto scheme = LookAndFeel_V4::ColourScheme(
         juce::Colour(BACKGROUND),                 // windowBackground
@@ -81,6 +92,20 @@ public:
     auto textArea = bounds.reduced(4.0f, 0.0f);
     g.drawText(button.getButtonText(), textArea.toNearestInt(),
                juce::Justification::centred, true);
+
+    // Parallel marker on the edge shared with the tab it runs alongside
+    if (button.getProperties()[parallelProperty]) {
+      g.setColour(juce::Colour(HIGHLIGHT));
+      g.fillRect(bounds.withWidth(2.0f).reduced(0.0f, 4.0f));
+    }
+
+    // CPU readout
+    if (auto *load = button.getProperties().getVarPointer(cpuLoadProperty)) {
+      g.setColour(textColour.withMultipliedAlpha(0.5f));
+      g.setFont(10.0f);
+      g.drawText(formatCpuLoad(*load), textArea.reduced(2.0f, 0.0f).toNearestInt(),
+                 juce::Justification::centredRight, false);
+    }
   }
 
   int getTabButtonBestWidth(juce::TabBarButton &button, int tabDepth) override {
@@ -20,9 +20,7 @@ PluginEditor::PluginEditor(PluginProcessor &p)
 
   // Load DSP order and populate tabs
   auto dspOrder = audioProcessor.getDspOrderFromState();
-  for (const auto &dspOption : dspOrder) {
-    tabBar.addTab(dspOption);
-  }
+  tabBar.setDspOrder(dspOrder);
 
   // Register listeners
   tabBar.addTabOrderListener(this);
@@ -31,9 +29,9 @@ PluginEditor::PluginEditor(PluginProcessor &p)
   // Set current tab
   auto savedTab = audioProcessor.getSelectedTabFromState();
   int savedTabIndex = 0;
-  for (int i = 0; i < dspOrder.size(); ++i) {
+  for (size_t i = 0; i < dspOrder.size(); ++i) {
     if (dspOrder[i] == savedTab) {
-      savedTabIndex = i;
+      savedTabIndex = static_cast<int>(i);
       break;
     }
   }
@@ -46,10 +44,30 @@ PluginEditor::PluginEditor(PluginProcessor &p)
   addChildComponent(filterPanel);
   showDspPanel(savedTab);
 
+  // Whole-instance CPU load, drawn over the analyzer's top right corner
+  cpuLabel.setJustificationType(juce::Justification::centredRight);
+  cpuLabel.setFont(juce::Font(11.0f));
+  cpuLabel.setColour(juce::Label::textColourId,
+                     juce::Colour(LookAndFeel::TEXT).withAlpha(0.5f));
+  cpuLabel.setInterceptsMouseClicks(false, false);
+  addAndMakeVisible(cpuLabel);
+  audioProcessor.profiler.setEnabled(true);
+
+  // Only changes anything on buses wider than one channel group
+  multiCoreButton.setToggleState(audioProcessor.isMultiCoreEnabled(),
+                                 juce::dontSendNotification);
+  multiCoreButton.onClick = [this] {
+    audioProcessor.setMultiCoreEnabled(multiCoreButton.getToggleState());
+  };
+  addAndMakeVisible(multiCoreButton);
+  startTimerHz(4);
+
   setSize(800, 450);
 }
 
 PluginEditor::~PluginEditor() {
+  stopTimer();
+  audioProcessor.profiler.setEnabled(false);
   tabBar.removeTabOrderListener(this);
   tabBar.removeTabSelectionListener(this);
   setLookAndFeel(nullptr);
@@ -57,7 +75,7 @@ PluginEditor::~PluginEditor() {
 
 void PluginEditor::tabOrderChanged(DspOrder newOrder) {
   audioProcessor.saveDspOrderToState(newOrder);
-  audioProcessor.dspOrderFifo.push(newOrder);
+  audioProcessor.publishDspOrder(newOrder);
 }
 
 void PluginEditor::tabSelectionChanged(int newSelectionIndex,
@@ -74,6 +92,17 @@ void PluginEditor::showDspPanel(DspOption dspOption) {
   filterPanel.setVisible(dspOption == DspOption::Filter);
 }
 
+void PluginEditor::timerCallback() {
+  auto snapshot = audioProcessor.profiler.takeSnapshot();
+  if (!snapshot.isValid) {
+    return;
+  }
+
+  tabBar.setCpuLoads(snapshot.slotLoad);
+  cpuLabel.setText("CPU " + LookAndFeel::formatCpuLoad(snapshot.totalLoad),
+                   juce::dontSendNotification);
+}
+
 void PluginEditor::paint(juce::Graphics &g) {
   g.fillAll(
       getLookAndFeel().findColour(juce::ResizableWindow::backgroundColourId));
@@ -95,6 +124,10 @@ void PluginEditor::resized() {
 
   // Spectrum analyzer - reduced height to give more space to effect panels
   spectrumAnalyzer.setBounds(bounds.removeFromTop(260));
+  auto cpuBounds =
+      spectrumAnalyzer.getBounds().reduced(6).removeFromRight(90);
+  cpuLabel.setBounds(cpuBounds.removeFromTop(16));
+  multiCoreButton.setBounds(cpuBounds.removeFromTop(20));
 
   // Small gap before tabs
   bounds.removeFromTop(3);
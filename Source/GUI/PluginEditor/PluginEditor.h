@@ -16,7 +16,8 @@
 //==============================================================================
 class PluginEditor : public juce::AudioProcessorEditor,
                      public TabOrderListener,
-                     public TabSelectionListener {
+                     public TabSelectionListener,
+                     private juce::Timer {
 public:
   PluginEditor(PluginProcessor &);
   ~PluginEditor() override;
@@ -32,6 +33,7 @@ private:
   PluginProcessor &audioProcessor;
 
   void showDspPanel(DspOption dspOption);
+  void timerCallback() override;
 
   ExtendedTabbedButtonBar tabBar;
   SpectrumAnalyzer spectrumAnalyzer;
@@ -43,6 +45,8 @@ private:
   FilterPanel filterPanel;
   Input input;
   Output output;
+  juce::Label cpuLabel;
+  juce::ToggleButton multiCoreButton{"Multi-core"};
 
   juce::Rectangle<int> dspPanelBounds;  // Track DSP panel area for border
 
@@ -1,80 +1,815 @@
 #include "DSP.h"
+#include "../../Utils/Profiling/DspProfiler.h"
 
-DSP::DSP(Parameters &params, juce::AudioProcessor &processor)
-    : leftChannel(params, processor), rightChannel(params, processor),
-      parameters(params) {}
+// DSP ORDER
+//==============================================================================
+DspOrder DspOrder::getDefault() {
+  DspOrder order;
+  for (size_t i = 0; i < numDspOptions; ++i) {
+    order.add(static_cast<DspOption>(i));
+  }
+  return order;
+}
+
+bool DspOrder::canAdd(DspOption option) const {
+  return option != DspOption::END_OF_LIST && length < maxChainLength &&
+         count(option) < maxInstancesPerOption;
+}
+
+bool DspOrder::insert(size_t index, DspOption option) {
+  if (!canAdd(option) || index > length) {
+    return false;
+  }
+
+  auto shiftUp = [this, index](auto &values) {
+    const auto first = values.begin() + static_cast<std::ptrdiff_t>(index);
+    const auto last = values.begin() + static_cast<std::ptrdiff_t>(length);
+    std::move_backward(first, last, last + 1);
+  };
+  shiftUp(options);
+  shiftUp(parallel);
+  shiftUp(branchGains);
+
+  options[index] = option;
+  parallel[index] = false;
+  branchGains[index] = 1.f;
+  ++length;
+  assignInstances();
+  return true;
+}
+
+void DspOrder::remove(size_t index) {
+  if (index >= length) {
+    return;
+  }
+
+  auto shiftDown = [this, index](auto &values) {
+    std::move(values.begin() + static_cast<std::ptrdiff_t>(index + 1),
+              values.begin() + static_cast<std::ptrdiff_t>(length),
+              values.begin() + static_cast<std::ptrdiff_t>(index));
+  };
+  shiftDown(options);
+  shiftDown(parallel);
+  shiftDown(branchGains);
+
+  --length;
+  if (length > 0) {
+    parallel[0] = false;
+  }
+  assignInstances();
+}
+
+void DspOrder::setParallel(size_t index, bool shouldBeParallel) {
+  if (index > 0 && index < length) {
+    parallel[index] = shouldBeParallel;
+  }
+}
+
+size_t DspOrder::getSectionEnd(size_t index) const {
+  auto end = index + 1;
+  while (end < length && parallel[end]) {
+    ++end;
+  }
+  return end;
+}
+
+bool DspOrder::operator==(const DspOrder &other) const {
+  if (length != other.length) {
+    return false;
+  }
+  for (size_t i = 0; i < length; ++i) {
+    if (options[i] != other.options[i] || parallel[i] != other.parallel[i] ||
+        branchGains[i] != other.branchGains[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+size_t DspOrder::count(DspOption option) const {
+  return static_cast<size_t>(std::count(begin(), end(), option));
+}
 
-void DSP::prepareToPlay(const juce::dsp::ProcessSpec &spec) {
-  leftChannel.prepare(spec);
-  rightChannel.prepare(spec);
+void DspOrder::assignInstances() {
+  std::array<size_t, numDspOptions> used{};
+  for (size_t i = 0; i < length; ++i) {
+    instances[i] = used[static_cast<size_t>(options[i])]++;
+  }
+}
+
+namespace {
+// MID/SIDE
+//==============================================================================
+// The left and right channels of a stereo bus are turned into mid and side
+// in place. Halving on the way in makes the decode a plain
+// sum and difference, so the round trip is transparent with every effect
+// bypassed.
+template <typename SampleType>
+void encodeMidSide(juce::dsp::AudioBlock<SampleType> block) {
+  auto *left = block.getChannelPointer(0);
+  auto *right = block.getChannelPointer(1);
+  for (size_t i = 0; i < block.getNumSamples(); ++i) {
+    const auto mid = (left[i] + right[i]) * SampleType(0.5);
+    const auto side = (left[i] - right[i]) * SampleType(0.5);
+    left[i] = mid;
+    right[i] = side;
+  }
 }
 
-void DSP::processBlock(juce::dsp::AudioBlock<float> leftBlock,
-                       juce::dsp::AudioBlock<float> rightBlock,
-                       const DspOrder &dspOrder) {
-  leftChannel.update();
-  rightChannel.update();
-  leftChannel.process(leftBlock, dspOrder);
-  rightChannel.process(rightBlock, dspOrder);
+template <typename SampleType>
+void decodeMidSide(juce::dsp::AudioBlock<SampleType> block) {
+  auto *mid = block.getChannelPointer(0);
+  auto *side = block.getChannelPointer(1);
+  for (size_t i = 0; i < block.getNumSamples(); ++i) {
+    const auto left = mid[i] + side[i];
+    const auto right = mid[i] - side[i];
+    mid[i] = left;
+    side[i] = right;
+  }
 }
 
-// DSP CHANNEL
+// TAILS
 //==============================================================================
-DSP::DspChannel::DspChannel(Parameters &params, juce::AudioProcessor &proc)
-    : parameters(params), processor(proc) {}
+// Rough times for each effect's output to fall 100 dB once its input stops,
+// from full scale to the silence threshold. A feedback loop with a gain of g
+// has to go round log(100000) / -log|g| times to get there.
+constexpr double tailDecay = 11.512925464970229; // log(100000)
+
+double getRepeatsToDecay(double feedback) {
+  const auto gain = std::abs(feedback);
+  return gain < 1.0e-3 ? 0.0 : tailDecay / -std::log(juce::jmin(gain, 0.999));
+}
+
+// juce::dsp::Phaser runs six first-order all-passes in its loop, each of
+// which delays its break frequency by 1 / (2 pi f)
+double getPhaserTailSeconds(double feedback, double centreFrequency) {
+  const auto loopSeconds =
+      6.0 / (juce::MathConstants<double>::twoPi *
+             juce::jmax(1.0, centreFrequency));
+  return loopSeconds * (1.0 + getRepeatsToDecay(feedback));
+}
+
+// juce::dsp::Chorus sweeps its delay up to 20 ms past the centre at full
+// depth
+double getChorusTailSeconds(double feedback, double centreDelayMs,
+                            double depth) {
+  const auto loopSeconds = (centreDelayMs + 20.0 * depth) * 1.0e-3;
+  return loopSeconds * (1.0 + getRepeatsToDecay(feedback));
+}
+
+// The ladder's poles close in on the unit circle as the resonance nears 1,
+// where it self-oscillates
+double getLadderFilterTailSeconds(double cutoff, double resonance) {
+  const auto damping = juce::jmax(1.0e-3, 1.0 - resonance);
+  return tailDecay / (juce::MathConstants<double>::twoPi *
+                      juce::jmax(1.0, cutoff) * damping);
+}
+
+// A resonance of quality Q decays with a time constant of Q / (pi f)
+double getFilterTailSeconds(double frequency, double quality) {
+  return tailDecay * quality /
+         (juce::MathConstants<double>::pi * juce::jmax(1.0, frequency));
+}
+} // namespace
+
+// DSP
+//==============================================================================
+template <typename SampleType>
+DSP<SampleType>::DSP(Parameters &params, DspProfiler &profiler,
+                     WorkerPool &workers)
+    : dspOrder(DspOrder::getDefault()), parameters(params), profiler(profiler),
+      workers(workers) {}
+
+template <typename SampleType>
+void DSP<SampleType>::prepareToPlay(const juce::dsp::ProcessSpec &spec) {
+  jassert(spec.numChannels <= static_cast<juce::uint32>(maxDspChannels));
+  numChannels = spec.numChannels;
+  maximumBlockSize = juce::jmax<size_t>(1, spec.maximumBlockSize);
+  sampleRate = spec.sampleRate;
+
+  const auto numGroups =
+      (numChannels + channelsPerGroup - 1) / channelsPerGroup;
+  chains.resize(numGroups);
+  shadowChains.resize(numGroups);
+  tickControls.resize((maximumBlockSize + controlInterval - 1) /
+                      controlInterval);
+
+  // Nothing is playing to fade from, so a queued order is taken as it is
+  if (hasQueuedOrder) {
+    dspOrder = queuedOrder;
+    hasQueuedOrder = false;
+  }
+  transitioning = false;
+  transitionLength = static_cast<size_t>(
+      juce::jmax(1.0, std::round(transitionSeconds * spec.sampleRate)));
+
+  blockControls = readBlockControls();
+  for (size_t group = 0; group < numGroups; ++group) {
+    auto groupSpec = spec;
+    groupSpec.numChannels = static_cast<juce::uint32>(juce::jmin(
+        channelsPerGroup, numChannels - group * channelsPerGroup));
+
+    for (auto *groupChains : {&chains, &shadowChains}) {
+      auto &chain = (*groupChains)[group];
+      if (chain == nullptr) {
+        chain = std::make_unique<DspChain>(profiler);
+      }
+      chain->prepare(groupSpec, blockControls);
+    }
+    chains[group]->setDspOrder(dspOrder);
+  }
+
+  TickControls tick;
+  for (size_t i = 0; i < Parameters::numSmoothedParameters; ++i) {
+    tick.smoothed[i] = parameters.getSmoothedValue(
+        static_cast<Parameters::SmoothedParameter>(i));
+  }
+  tailSeconds.store(computeTailSeconds(tick));
+  silentSamples = 0;
+  asleep = false;
+}
 
-void DSP::DspChannel::prepare(const juce::dsp::ProcessSpec &spec) {
-  jassert(spec.numChannels == 1);
+template <typename SampleType>
+void DSP<SampleType>::setDspOrder(const DspOrder &newDspOrder) {
+  // Before the first prepareToPlay there is nothing to fade from
+  if (chains.empty()) {
+    dspOrder = newDspOrder;
+    return;
+  }
+
+  const auto &latestOrder = hasQueuedOrder ? queuedOrder : dspOrder;
+  if (newDspOrder == latestOrder) {
+    return;
+  }
+  queuedOrder = newDspOrder;
+  hasQueuedOrder = true;
+}
+
+template <typename SampleType>
+typename DSP<SampleType>::BlockControls
+DSP<SampleType>::readBlockControls() const {
+  BlockControls controls;
+  // Indexed by DspOption
+  controls.bypassed = {parameters.phaserBypass->get(),
+                       parameters.chorusBypass->get(),
+                       parameters.overdriveBypass->get(),
+                       parameters.ladderFilterBypass->get(),
+                       parameters.filterBypass->get()};
+  controls.routing = {
+      static_cast<MidSideRouting>(parameters.phaserRouting->getIndex()),
+      static_cast<MidSideRouting>(parameters.chorusRouting->getIndex()),
+      static_cast<MidSideRouting>(parameters.overdriveRouting->getIndex()),
+      static_cast<MidSideRouting>(parameters.ladderFilterRouting->getIndex()),
+      static_cast<MidSideRouting>(parameters.filterRouting->getIndex())};
+  controls.midSide = parameters.stereoMode->getIndex() == 1;
+  controls.oversamplingOrder = parameters.overdriveOversampling->getIndex();
+  controls.ladderFilterMode = parameters.ladderFilterMode->getIndex();
+  controls.filterMode = parameters.filterMode->getIndex();
+  return controls;
+}
+
+template <typename SampleType>
+void DSP<SampleType>::processBlock(juce::dsp::AudioBlock<SampleType> block) {
+  // The control ticks and the oversamplers are sized for the prepared block
+  // size, so a larger block from the host is split up
+  const auto numSamples = block.getNumSamples();
+  for (size_t offset = 0; offset < numSamples; offset += maximumBlockSize) {
+    processChunk(block.getSubBlock(
+        offset, juce::jmin(maximumBlockSize, numSamples - offset)));
+  }
+}
+
+template <typename SampleType>
+void DSP<SampleType>::processChunk(juce::dsp::AudioBlock<SampleType> block) {
+  // Step the smoothers through every control tick of the chunk up front, so
+  // each channel group can then run the whole chunk on its own
+  const auto numSamples = block.getNumSamples();
+  {
+    DspProfiler::ScopedStageTimer timer(profiler,
+                                        DspProfiler::Stage::Parameters);
+    blockControls = readBlockControls();
+    size_t numTicks = 0;
+    for (size_t offset = 0; offset < numSamples; offset += controlInterval) {
+      const auto numTickSamples =
+          juce::jmin(static_cast<size_t>(controlInterval), numSamples - offset);
+      parameters.advanceSmoothers(static_cast<int>(numTickSamples));
+      auto &tick = tickControls[numTicks++];
+      for (size_t i = 0; i < Parameters::numSmoothedParameters; ++i) {
+        tick.smoothed[i] = parameters.getSmoothedValue(
+            static_cast<Parameters::SmoothedParameter>(i));
+      }
+    }
+    tailSeconds.store(computeTailSeconds(tickControls[numTicks - 1]),
+                      std::memory_order_relaxed);
+  }
+
+  currentChunk = block.getSubsetChannelBlock(
+      0, juce::jmin(block.getNumChannels(), numChannels));
+
+  // A sleeping chain is skipped altogether, see SILENCE
+  const auto inputSilent = isSilent(currentChunk);
+  silentSamples = inputSilent ? silentSamples + numSamples : 0;
+  if (asleep && inputSilent) {
+    sleepThroughChunk();
+    return;
+  }
+  asleep = false;
+
+  if (!transitioning && hasQueuedOrder) {
+    beginTransition();
+  }
+  if (transitioning) {
+    // Each group ramps the incoming chain's gain on from here, sample by
+    // sample through the chunk
+    transitionStep = static_cast<SampleType>(1.0 / transitionLength);
+    transitionStart =
+        static_cast<SampleType>(transitionPosition) * transitionStep;
+  }
+
+  // In M/S mode the first group sees mid and side where left and right were,
+  // so they share a chain and sit side by side in its SIMD lanes. Only a
+  // stereo bus has them to itself: on a wider one the group's other lanes
+  // would go through the mid/side routing too.
+  const auto midSide =
+      blockControls.midSide && currentChunk.getNumChannels() == 2;
+  if (midSide) {
+    encodeMidSide(currentChunk);
+  }
+  // With the worker pool running, groups run in parallel on the workers and
+  // this thread, otherwise one after the other here
+  workers.run(chains.size(), &DSP::processGroupJob, this);
+  if (midSide) {
+    decodeMidSide(currentChunk);
+  }
+
+  if (transitioning) {
+    transitionPosition += numSamples;
+    if (transitionPosition >= transitionLength) {
+      // The new order is fully faded in, the old chains retire to the shadow
+      // slots
+      for (size_t group = 0; group < chains.size(); ++group) {
+        std::swap(chains[group], shadowChains[group]);
+      }
+      transitioning = false;
+    }
+  }
+
+  // Sleep from the next chunk on if the tails have had time to ring out
+  const auto tailSamples =
+      static_cast<size_t>(tailSeconds.load(std::memory_order_relaxed) *
+                          sampleRate) +
+      static_cast<size_t>(getLatencySamples());
+  asleep = inputSilent && !transitioning && silentSamples > tailSamples;
+}
+
+template <typename SampleType>
+bool DSP<SampleType>::isSilent(juce::dsp::AudioBlock<const SampleType> block) {
+  const auto range = block.findMinAndMax();
+  return range.getStart() > -silenceThreshold &&
+         range.getEnd() < silenceThreshold;
+}
+
+template <typename SampleType> void DSP<SampleType>::sleepThroughChunk() {
+  currentChunk.clear();
 
-  std::vector<juce::dsp::ProcessorBase *> dsp{&phaser, &chorus, &overdrive,
-                                              &ladderFilter, &filter};
+  // Nor can the latency held over from an order change be heard dropping
+  for (auto &chain : chains) {
+    chain->clearLatencyPadding();
+  }
 
-  for (auto processor : dsp) {
-    processor->prepare(spec);
-    processor->reset();
+  // Nothing is ringing, so a new order can be taken up without a crossfade
+  if (hasQueuedOrder) {
+    dspOrder = queuedOrder;
+    hasQueuedOrder = false;
+    for (auto &chain : chains) {
+      chain->restart(dspOrder, blockControls);
+    }
   }
+}
+
+template <typename SampleType>
+double DSP<SampleType>::computeTailSeconds(const TickControls &tick) const {
+  using Smoothed = Parameters::SmoothedParameter;
 
-  // Set default filter settings for overdrive
-  overdrive.dsp.setMode(juce::dsp::LadderFilterMode::LPF12);
-  overdrive.dsp.setCutoffFrequencyHz(20000.0f);
-  overdrive.dsp.setResonance(0);
+  // Indexed by DspOption, a Drive has no tail beyond its latency
+  const std::array<double, numDspOptions> tails = {
+      getPhaserTailSeconds(tick[Smoothed::PhaserFeedback],
+                           tick[Smoothed::PhaserCenterFreq]),
+      getChorusTailSeconds(tick[Smoothed::ChorusFeedback],
+                           tick[Smoothed::ChorusCenterDelay],
+                           tick[Smoothed::ChorusDepth]),
+      0.0,
+      getLadderFilterTailSeconds(tick[Smoothed::LadderFilterCutoff],
+                                 tick[Smoothed::LadderFilterResonance]),
+      getFilterTailSeconds(tick[Smoothed::FilterFreq],
+                           tick[Smoothed::FilterQuality])};
+
+  // Tails add up along the chain, a section rings as long as its longest
+  // branch
+  double tail = 0.0;
+  for (size_t first = 0; first < dspOrder.size();
+       first = dspOrder.getSectionEnd(first)) {
+    double sectionTail = 0.0;
+    for (auto i = first; i < dspOrder.getSectionEnd(first); ++i) {
+      const auto option = static_cast<size_t>(dspOrder[i]);
+      if (!blockControls.bypassed[option]) {
+        sectionTail = juce::jmax(sectionTail, tails[option]);
+      }
+    }
+    tail += sectionTail;
+  }
+  return juce::jmin(tail, maxTailSeconds);
 }
 
-void DSP::DspChannel::update() {
+template <typename SampleType> void DSP<SampleType>::beginTransition() {
+  DspProfiler::ScopedStageTimer timer(profiler,
+                                      DspProfiler::Stage::OrderTransition);
+  dspOrder = queuedOrder;
+  hasQueuedOrder = false;
+  for (auto &chain : shadowChains) {
+    chain->restart(dspOrder, blockControls);
+  }
+
+  // Line the incoming order up with the outgoing one, see ORDER TRANSITIONS.
+  // Every group runs the same order, so the first one speaks for all of them.
+  const auto latency = chains.front()->getLatencySamples();
+  for (auto &chain : shadowChains) {
+    chain->padLatencyTo(latency);
+  }
+  transitioning = true;
+  transitionPosition = 0;
+}
+
+template <typename SampleType>
+void DSP<SampleType>::crossfadeOrders(
+    juce::dsp::AudioBlock<SampleType> outgoing,
+    juce::dsp::AudioBlock<const SampleType> incoming, size_t offset) const {
+  // offset is where the blocks start within the chunk
+  const auto start =
+      transitionStart + static_cast<SampleType>(offset) * transitionStep;
+  for (size_t channel = 0; channel < outgoing.getNumChannels(); ++channel) {
+    auto *out = outgoing.getChannelPointer(channel);
+    const auto *in = incoming.getChannelPointer(channel);
+    for (size_t i = 0; i < outgoing.getNumSamples(); ++i) {
+      const auto gain = juce::jmin<SampleType>(
+          1, start + static_cast<SampleType>(i + 1) * transitionStep);
+      out[i] += gain * (in[i] - out[i]);
+    }
+  }
+}
+
+template <typename SampleType>
+void DSP<SampleType>::processGroupJob(void *dsp, size_t groupIndex) {
+  auto &self = *static_cast<DSP *>(dsp);
+  self.processGroup(groupIndex, self.currentChunk);
+}
+
+template <typename SampleType>
+void DSP<SampleType>::processGroup(size_t groupIndex,
+                                   juce::dsp::AudioBlock<SampleType> block) {
+  const auto firstChannel = groupIndex * channelsPerGroup;
+  if (firstChannel >= block.getNumChannels()) {
+    return;
+  }
+
+  auto &chain = *chains[groupIndex];
+  auto groupBlock = block.getSubsetChannelBlock(
+      firstChannel,
+      juce::jmin(channelsPerGroup, block.getNumChannels() - firstChannel));
+  const auto holdsMidSide =
+      groupIndex == 0 && blockControls.midSide && block.getNumChannels() == 2;
+  chain.updateBypassStates(blockControls);
+  chain.updateRouting(blockControls, holdsMidSide);
+
+  // The chain fading in a new order, if there is one
+  auto *incoming = transitioning ? shadowChains[groupIndex].get() : nullptr;
+  if (incoming != nullptr) {
+    incoming->updateBypassStates(blockControls);
+    incoming->updateRouting(blockControls, holdsMidSide);
+  }
+
+  // Run the chain in control ticks so every module sees parameter updates at
+  // the same rate whatever the host block size is
+  const auto numSamples = groupBlock.getNumSamples();
+  for (size_t offset = 0, tick = 0; offset < numSamples;
+       offset += controlInterval, ++tick) {
+    const auto numTickSamples =
+        juce::jmin(static_cast<size_t>(controlInterval), numSamples - offset);
+    auto tickBlock = groupBlock.getSubBlock(offset, numTickSamples);
+    {
+      DspProfiler::ScopedStageTimer timer(profiler,
+                                          DspProfiler::Stage::Parameters);
+      chain.update(blockControls, tickControls[tick]);
+    }
+
+    if (incoming == nullptr) {
+      chain.process(tickBlock);
+      continue;
+    }
+
+    auto incomingBlock =
+        juce::dsp::AudioBlock<SampleType>(incoming->transitionInput)
+            .getSubsetChannelBlock(0, tickBlock.getNumChannels())
+            .getSubBlock(0, numTickSamples);
+    {
+      DspProfiler::ScopedStageTimer timer(
+          profiler, DspProfiler::Stage::OrderTransition);
+      incomingBlock.copyFrom(tickBlock);
+    }
+    chain.process(tickBlock);
+
+    {
+      DspProfiler::ScopedStageTimer timer(profiler,
+                                          DspProfiler::Stage::Parameters);
+      incoming->update(blockControls, tickControls[tick]);
+    }
+    // Its slots count their own time, like the outgoing chain's
+    incoming->process(incomingBlock);
+
+    DspProfiler::ScopedStageTimer timer(profiler,
+                                        DspProfiler::Stage::OrderTransition);
+    crossfadeOrders(tickBlock, incomingBlock, offset);
+  }
+}
+
+// DSP CHAIN
+//==============================================================================
+template <typename SampleType>
+DSP<SampleType>::DspChain::DspChain(DspProfiler &prof) : profiler(prof) {}
+
+template <typename SampleType>
+void DSP<SampleType>::DspChain::prepare(const juce::dsp::ProcessSpec &spec,
+                                        const BlockControls &controls) {
+  // Start at the stored oversampling factor, which reset() takes over, so the
+  // latency reported after prepareToPlay is already the final one
+  for (auto &overdrive : overdrives) {
+    overdrive.setOversamplingOrder(controls.oversamplingOrder);
+  }
+
+  auto preparePool = [&spec](auto &pool) {
+    for (auto &effect : pool) {
+      effect.prepare(spec);
+      effect.reset();
+    }
+  };
+  preparePool(phasers);
+  preparePool(choruses);
+  preparePool(overdrives);
+  preparePool(ladderFilters);
+  preparePool(filters);
+  cachedFilterMode = FilterMode::END_OF_LIST;
+
+  // Bypass crossfades run one control tick at a time on a copy of the input
+  dryBuffer.setSize(static_cast<int>(spec.numChannels), controlInterval);
+
+  // Parallel branches too, and at most every slot but one is a branch with
+  // its own copy. Only a Drive adds latency for the others to make up.
+  branchArena.setSize(static_cast<int>(spec.numChannels * (maxChainLength - 1)),
+                      controlInterval);
+  for (auto &delay : branchDelays) {
+    delay.setMaximumDelayInSamples(overdrives[0].getMaxLatencySamples() + 1);
+    delay.prepare(spec);
+  }
+  fadeStep = static_cast<SampleType>(
+      1.0 / juce::jmax(1.0, bypassFadeSeconds * spec.sampleRate));
+  transitionInput.setSize(static_cast<int>(spec.numChannels), controlInterval);
+
+  // An order is at most one Drive per instance late
+  maxPadding = static_cast<int>(maxInstancesPerOption) *
+               overdrives[0].getMaxLatencySamples();
+  outputHistory.setSize(static_cast<int>(spec.numChannels),
+                        maxPadding + controlInterval);
+  outputHistory.clear();
+  historyPosition = 0;
+  padding = 0;
+
+  // Start in the stored bypass states rather than fading into them
+  snapBypassStates(controls);
+}
+
+template <typename SampleType>
+void DSP<SampleType>::DspChain::snapBypassStates(
+    const BlockControls &controls) {
+  for (size_t option = 0; option < numDspOptions; ++option) {
+    for (auto &slot : slots[option]) {
+      slot.state = controls.bypassed[option] ? SlotState::Bypassed
+                                             : SlotState::Active;
+      slot.wetGain = controls.bypassed[option] ? 0 : 1;
+    }
+  }
+}
+
+template <typename SampleType>
+template <DspOption Option>
+auto &DSP<SampleType>::DspChain::getProcessor(size_t instance) {
+  if constexpr (Option == DspOption::Phase) {
+    return phasers[instance];
+  } else if constexpr (Option == DspOption::Chorus) {
+    return choruses[instance];
+  } else if constexpr (Option == DspOption::OverDrive) {
+    return overdrives[instance];
+  } else if constexpr (Option == DspOption::LadderFilter) {
+    return ladderFilters[instance];
+  } else {
+    static_assert(Option == DspOption::Filter, "Unhandled DspOption");
+    return filters[instance];
+  }
+}
+
+template <typename SampleType>
+void DSP<SampleType>::DspChain::setDspOrder(const DspOrder &dspOrder) {
+  order = dspOrder;
+
+  PerInstance<bool> nowInOrder{};
+  for (size_t i = 0; i < order.size(); ++i) {
+    nowInOrder[static_cast<size_t>(order[i])][order.getInstance(i)] = true;
+  }
+
+  // Instances joining the chain drop whatever they held when they last left
+  // it, and pick up the parameters at the next update
+  [&]<size_t... Option>(std::index_sequence<Option...>) {
+    (
+        [&] {
+          for (size_t instance = 0; instance < maxInstancesPerOption;
+               ++instance) {
+            if (nowInOrder[Option][instance] && !inOrder[Option][instance]) {
+              this->template getProcessor<static_cast<DspOption>(Option)>(
+                      instance)
+                  .reset();
+            }
+          }
+        }(),
+        ...);
+  }(std::make_index_sequence<numDspOptions>{});
+
+  inOrder = nowInOrder;
+  cachedFilterMode = FilterMode::END_OF_LIST;
+}
+
+template <typename SampleType>
+void DSP<SampleType>::DspChain::restart(const DspOrder &dspOrder,
+                                        const BlockControls &controls) {
+  // With nothing counted as in the chain, every instance of the order joins
+  // it and is reset
+  inOrder = {};
+  setDspOrder(dspOrder);
+  for (auto &delay : branchDelays) {
+    delay.reset();
+  }
+  clearLatencyPadding();
+  snapBypassStates(controls);
+}
+
+template <typename SampleType>
+int DSP<SampleType>::DspChain::getLatencySamples() const {
+  return getOrderLatencySamples() + padding;
+}
+
+template <typename SampleType>
+void DSP<SampleType>::DspChain::padLatencyTo(int latency) {
+  padding = juce::jlimit(0, maxPadding, latency - getOrderLatencySamples());
+}
+
+template <typename SampleType>
+void DSP<SampleType>::DspChain::clearLatencyPadding() {
+  // Only a padded chain records its history
+  if (padding > 0) {
+    padding = 0;
+    outputHistory.clear();
+    historyPosition = 0;
+  }
+}
+
+template <typename SampleType>
+int DSP<SampleType>::DspChain::getOrderLatencySamples() const {
+  // Each section is as late as its slowest branch
+  int latency = 0;
+  for (size_t first = 0; first < order.size();
+       first = order.getSectionEnd(first)) {
+    int sectionLatency = 0;
+    for (auto i = first; i < order.getSectionEnd(first); ++i) {
+      sectionLatency = juce::jmax(sectionLatency, getSlotLatency(i));
+    }
+    latency += sectionLatency;
+  }
+  return latency;
+}
+
+template <typename SampleType>
+int DSP<SampleType>::DspChain::getSlotLatency(size_t index) const {
+  return order[index] == DspOption::OverDrive
+             ? overdrives[order.getInstance(index)].getLatencySamples()
+             : 0;
+}
+
+template <typename SampleType>
+template <DspOption Option>
+void DSP<SampleType>::DspChain::updateBypassState(bool shouldBeBypassed) {
+  for (size_t instance = 0; instance < maxInstancesPerOption; ++instance) {
+    auto &slot = slots[static_cast<size_t>(Option)][instance];
+
+    if (shouldBeBypassed) {
+      if (slot.state == SlotState::Active ||
+          slot.state == SlotState::FadingIn) {
+        slot.state = SlotState::FadingOut;
+      }
+    } else if (slot.state == SlotState::Bypassed) {
+      // The processor has been dormant, so clear whatever it held when it
+      // went to sleep. update() runs before the first faded tick and brings
+      // its parameters up to date.
+      this->template getProcessor<Option>(instance).reset();
+      slot.state = SlotState::FadingIn;
+      if constexpr (Option == DspOption::Filter) {
+        cachedFilterMode = FilterMode::END_OF_LIST; // Push a fresh target
+      }
+    } else if (slot.state == SlotState::FadingOut) {
+      slot.state = SlotState::FadingIn;
+    }
+  }
+}
+
+template <typename SampleType>
+void DSP<SampleType>::DspChain::updateBypassStates(
+    const BlockControls &controls) {
+  [&]<size_t... Option>(std::index_sequence<Option...>) {
+    (this->template updateBypassState<static_cast<DspOption>(Option)>(
+         controls.bypassed[Option]),
+     ...);
+  }(std::make_index_sequence<numDspOptions>{});
+}
+
+template <typename SampleType>
+void DSP<SampleType>::DspChain::updateRouting(const BlockControls &controls,
+                                              bool holdsMidSide) {
+  if (holdsMidSide) {
+    routing = controls.routing;
+  } else {
+    routing.fill(MidSideRouting::Both);
+  }
+}
+
+template <typename SampleType>
+template <DspOption Option, typename Function>
+void DSP<SampleType>::DspChain::forEachAwakeInstance(Function &&function) {
+  const auto option = static_cast<size_t>(Option);
+  for (size_t instance = 0; instance < maxInstancesPerOption; ++instance) {
+    if (inOrder[option][instance] &&
+        slots[option][instance].state != SlotState::Bypassed) {
+      function(this->template getProcessor<Option>(instance));
+    }
+  }
+}
+
+template <typename SampleType>
+void DSP<SampleType>::DspChain::update(const BlockControls &controls,
+                                       const TickControls &tick) {
+  using Smoothed = Parameters::SmoothedParameter;
+  auto value = [&tick](Smoothed smoothed) { return tick[smoothed]; };
+
+  // Dormant (fully bypassed) processors are left alone until they wake up
   // Phaser
-  phaser.dsp.setRate(parameters.phaserRateSmoother.getCurrentValue());
-  phaser.dsp.setCentreFrequency(
-      parameters.phaserCenterFreqSmoother.getCurrentValue());
-  phaser.dsp.setDepth(parameters.phaserDepthSmoother.getCurrentValue());
-  phaser.dsp.setFeedback(parameters.phaserFeedbackSmoother.getCurrentValue());
-  phaser.dsp.setMix(parameters.phaserMixSmoother.getCurrentValue());
+  forEachAwakeInstance<DspOption::Phase>([&](auto &phaser) {
+    phaser.setRate(value(Smoothed::PhaserRate));
+    phaser.setCentreFrequency(value(Smoothed::PhaserCenterFreq));
+    phaser.setDepth(value(Smoothed::PhaserDepth));
+    phaser.setFeedback(value(Smoothed::PhaserFeedback));
+    phaser.setMix(value(Smoothed::PhaserMix));
+  });
   // Chorus
-  chorus.dsp.setRate(parameters.chorusRateSmoother.getCurrentValue());
-  chorus.dsp.setDepth(parameters.chorusDepthSmoother.getCurrentValue());
-  chorus.dsp.setCentreDelay(
-      parameters.chorusCenterDelaySmoother.getCurrentValue());
-  chorus.dsp.setFeedback(parameters.chorusFeedbackSmoother.getCurrentValue());
-  chorus.dsp.setMix(parameters.chorusMixSmoother.getCurrentValue());
+  forEachAwakeInstance<DspOption::Chorus>([&](auto &chorus) {
+    chorus.setRate(value(Smoothed::ChorusRate));
+    chorus.setDepth(value(Smoothed::ChorusDepth));
+    chorus.setCentreDelay(value(Smoothed::ChorusCenterDelay));
+    chorus.setFeedback(value(Smoothed::ChorusFeedback));
+    chorus.setMix(value(Smoothed::ChorusMix));
+  });
   // Drive
-  overdrive.dsp.setDrive(
-      parameters.overdriveSaturationSmoother.getCurrentValue());
+  forEachAwakeInstance<DspOption::OverDrive>([&](auto &overdrive) {
+    overdrive.setDrive(value(Smoothed::OverdriveSaturation));
+    overdrive.setOversamplingOrder(controls.oversamplingOrder);
+  });
   // Ladder Filter
-  ladderFilter.dsp.setMode(static_cast<juce::dsp::LadderFilterMode>(
-      parameters.ladderFilterMode->getIndex()));
-  ladderFilter.dsp.setCutoffFrequencyHz(
-      parameters.ladderFilterCutoffSmoother.getCurrentValue());
-  ladderFilter.dsp.setResonance(
-      parameters.ladderFilterResonanceSmoother.getCurrentValue());
-  ladderFilter.dsp.setDrive(
-      parameters.ladderFilterDriveSmoother.getCurrentValue());
+  forEachAwakeInstance<DspOption::LadderFilter>([&](auto &ladderFilter) {
+    ladderFilter.setMode(
+        static_cast<juce::dsp::LadderFilterMode>(controls.ladderFilterMode));
+    ladderFilter.setCutoffFrequencyHz(value(Smoothed::LadderFilterCutoff));
+    ladderFilter.setResonance(value(Smoothed::LadderFilterResonance));
+    ladderFilter.setDrive(value(Smoothed::LadderFilterDrive));
+  });
   // Filter
-  auto currentFilterFreq = parameters.filterFreqSmoother.getCurrentValue();
-  auto currentFilterQuality =
-      parameters.filterQualitySmoother.getCurrentValue();
-  auto currentFilterGain = parameters.filterGainSmoother.getCurrentValue();
-  auto currentFilterMode = parameters.filterMode->getIndex();
+  size_t numAwakeFilters = 0;
+  forEachAwakeInstance<DspOption::Filter>([&](auto &) { ++numAwakeFilters; });
+  if (numAwakeFilters == 0) {
+    return;
+  }
 
-  // Only update filter coefficients if mode changes or if values are changing
+  auto currentFilterFreq = value(Smoothed::FilterFreq);
+  auto currentFilterQuality = value(Smoothed::FilterQuality);
+  auto currentFilterGain = value(Smoothed::FilterGain);
+  auto currentFilterMode = controls.filterMode;
+
+  // Only set a new target if mode changes or if values are changing, the
+  // filter then ramps to it per sample over the next tick
   bool modeChanged = (currentFilterMode != cachedFilterMode);
   bool paramsChanging = (currentFilterFreq != cachedFilterFreq) ||
                         (currentFilterQuality != cachedFilterQuality) ||
@@ -86,84 +821,203 @@ void DSP::DspChannel::update() {
     cachedFilterQuality = currentFilterQuality;
     cachedFilterGain = currentFilterGain;
 
-    auto sampleRate = processor.getSampleRate();
-    juce::dsp::IIR::Coefficients<float>::Ptr coefficients;
-
-    switch (cachedFilterMode) {
-    case FilterMode::Peak: {
-      coefficients = juce::dsp::IIR::Coefficients<float>::makePeakFilter(
-          sampleRate, cachedFilterFreq, cachedFilterQuality,
-          juce::Decibels::decibelsToGain(cachedFilterGain));
-      break;
-    };
-    case FilterMode::Bandpass: {
-      coefficients = juce::dsp::IIR::Coefficients<float>::makeBandPass(
-          sampleRate, cachedFilterFreq, cachedFilterQuality);
-      break;
-    }
-    case FilterMode::Notch: {
-      coefficients = juce::dsp::IIR::Coefficients<float>::makeNotch(
-          sampleRate, cachedFilterFreq, cachedFilterQuality);
-      break;
-    };
-    case FilterMode::Allpass: {
-      coefficients = juce::dsp::IIR::Coefficients<float>::makeAllPass(
-          sampleRate, cachedFilterFreq, cachedFilterQuality);
-      break;
-    }
-    case FilterMode::END_OF_LIST: {
-      jassertfalse;
-      break;
-    }
-    }
-
-    if (coefficients != nullptr) {
-      *filter.dsp.coefficients = *coefficients;
-    }
-  }
-}
-
-void DSP::DspChannel::process(juce::dsp::AudioBlock<float> block,
-                              const DspOrder &dspOrder) {
-  // Convert dspOrder into pointers
-  DspPointers dspPointers;
-  dspPointers.fill({});
-
-  for (size_t i = 0; i < dspPointers.size(); ++i) {
-    switch (dspOrder[i]) {
-    case DspOption::Phase:
-      dspPointers[i].processor = &phaser;
-      dspPointers[i].bypassed = parameters.phaserBypass->get();
-      break;
-    case DspOption::Chorus:
-      dspPointers[i].processor = &chorus;
-      dspPointers[i].bypassed = parameters.chorusBypass->get();
-      break;
-    case DspOption::OverDrive:
-      dspPointers[i].processor = &overdrive;
-      dspPointers[i].bypassed = parameters.overdriveBypass->get();
-      break;
-    case DspOption::LadderFilter:
-      dspPointers[i].processor = &ladderFilter;
-      dspPointers[i].bypassed = parameters.ladderFilterBypass->get();
-      break;
-    case DspOption::Filter:
-      dspPointers[i].processor = &filter;
-      dspPointers[i].bypassed = parameters.filterBypass->get();
-      break;
-    case DspOption::END_OF_LIST:
-      jassertfalse;
-      break;
-    }
-  }
-
-  // Process
-  auto context = juce::dsp::ProcessContextReplacing<float>(block);
-  for (size_t i = 0; i < dspPointers.size(); ++i) {
-    if (dspPointers[i].processor != nullptr && !dspPointers[i].bypassed) {
-      juce::ScopedValueSetter<bool> svs(context.isBypassed,
-                                        dspPointers[i].bypassed);
-      dspPointers[i].processor->process(context);
+    forEachAwakeInstance<DspOption::Filter>([&](auto &filter) {
+      filter.setTarget(cachedFilterMode, cachedFilterFreq,
+                       cachedFilterQuality, cachedFilterGain);
+    });
+  }
+}
+
+template <typename SampleType>
+template <DspOption Option>
+void DSP<SampleType>::DspChain::processSlot(size_t instance,
+                                            const ProcessContext &context) {
+  auto &slot = slots[static_cast<size_t>(Option)][instance];
+  auto &processor = this->template getProcessor<Option>(instance);
+  if (slot.state == SlotState::Bypassed) {
+    if constexpr (Option == DspOption::OverDrive) {
+      // Keep the bypassed signal in line with the latency we report
+      processor.compensateLatency(context.getOutputBlock());
+    }
+    return;
+  }
+
+  const auto profiling = profiler.isEnabled();
+  const auto start = profiling ? DspProfiler::now() : 0;
+
+  const auto slotRouting = routing[static_cast<size_t>(Option)];
+  if (slot.state == SlotState::Active && slotRouting == MidSideRouting::Both) {
+    processor.process(context);
+  } else {
+    // Fading, or running on only one of mid and side: both need the input
+    // next to the output
+    const auto fading = slot.state != SlotState::Active;
+    auto &block = context.getOutputBlock();
+    auto dryBlock = juce::dsp::AudioBlock<SampleType>(dryBuffer)
+                        .getSubsetChannelBlock(0, block.getNumChannels())
+                        .getSubBlock(0, block.getNumSamples());
+    dryBlock.copyFrom(block);
+    if constexpr (Option == DspOption::OverDrive) {
+      processor.compensateLatency(dryBlock);
+    }
+    processor.process(context);
+    if (fading) {
+      crossfade(slot, dryBlock, block);
+    }
+
+    // The effect ran on both lanes, which costs the SIMD modules nothing and
+    // keeps its state in step, and the other signal is put back untouched
+    if (slotRouting != MidSideRouting::Both) {
+      const size_t untouched = slotRouting == MidSideRouting::Mid ? 1 : 0;
+      block.getSingleChannelBlock(untouched).copyFrom(
+          dryBlock.getSingleChannelBlock(untouched));
     }
   }
+
+  if (profiling) {
+    profiler.addSlotTicks(Option, DspProfiler::now() - start);
+  }
+}
+
+template <typename SampleType>
+void DSP<SampleType>::DspChain::crossfade(
+    Slot &slot, juce::dsp::AudioBlock<const SampleType> dryBlock,
+    juce::dsp::AudioBlock<SampleType> wetBlock) {
+  jassert(slot.state == SlotState::FadingIn ||
+          slot.state == SlotState::FadingOut);
+
+  const auto step = slot.state == SlotState::FadingIn ? fadeStep : -fadeStep;
+  const auto numSamples = wetBlock.getNumSamples();
+
+  for (size_t channel = 0; channel < wetBlock.getNumChannels(); ++channel) {
+    auto *wet = wetBlock.getChannelPointer(channel);
+    const auto *dry = dryBlock.getChannelPointer(channel);
+    auto gain = slot.wetGain;
+
+    for (size_t i = 0; i < numSamples; ++i) {
+      gain = juce::jlimit<SampleType>(0, 1, gain + step);
+      wet[i] = dry[i] + gain * (wet[i] - dry[i]);
+    }
+  }
+
+  slot.wetGain = juce::jlimit<SampleType>(
+      0, 1, slot.wetGain + step * static_cast<SampleType>(numSamples));
+  if (slot.wetGain >= 1) {
+    slot.state = SlotState::Active;
+  } else if (slot.wetGain <= 0) {
+    slot.state = SlotState::Bypassed;
+  }
+}
+
+template <typename SampleType>
+void DSP<SampleType>::DspChain::processSlotAt(size_t index,
+                                              const ProcessContext &context) {
+  static constexpr auto slotFunctions =
+      []<size_t... Option>(std::index_sequence<Option...>) {
+        return std::array<SlotFunction, numDspOptions>{
+            &DspChain::template processSlot<static_cast<DspOption>(Option)>...};
+      }(std::make_index_sequence<numDspOptions>{});
+
+  (this->*slotFunctions[static_cast<size_t>(order[index])])(
+      order.getInstance(index), context);
 }
+
+template <typename SampleType>
+juce::dsp::AudioBlock<SampleType> DSP<SampleType>::DspChain::getBranchBlock(
+    size_t branch, juce::dsp::AudioBlock<SampleType> block) {
+  jassert(branch > 0 && branch < maxChainLength);
+  const auto numChannels = block.getNumChannels();
+  return juce::dsp::AudioBlock<SampleType>(branchArena)
+      .getSubsetChannelBlock((branch - 1) * numChannels, numChannels)
+      .getSubBlock(0, block.getNumSamples());
+}
+
+template <typename SampleType>
+void DSP<SampleType>::DspChain::processSection(
+    size_t first, size_t end, juce::dsp::AudioBlock<SampleType> block) {
+  const auto numBranches = end - first;
+  if (numBranches == 1) {
+    processSlotAt(first, ProcessContext(block));
+    return;
+  }
+
+  for (size_t branch = 1; branch < numBranches; ++branch) {
+    getBranchBlock(branch, block).copyFrom(block);
+  }
+
+  int sectionLatency = 0;
+  for (auto i = first; i < end; ++i) {
+    sectionLatency = juce::jmax(sectionLatency, getSlotLatency(i));
+  }
+
+  std::array<SampleType, maxChainLength> gains{};
+  for (size_t branch = 0; branch < numBranches; ++branch) {
+    const auto index = first + branch;
+    auto branchBlock = branch == 0 ? block : getBranchBlock(branch, block);
+    processSlotAt(index, ProcessContext(branchBlock));
+
+    if (const auto delay = sectionLatency - getSlotLatency(index); delay > 0) {
+      branchDelays[index].setDelay(static_cast<SampleType>(delay));
+      branchDelays[index].process(ProcessContext(branchBlock));
+    }
+    gains[branch] = static_cast<SampleType>(order.getBranchGain(index));
+  }
+
+  // Merge every branch back into the section's block in one pass
+  std::array<const SampleType *, maxChainLength> sources{};
+  for (size_t channel = 0; channel < block.getNumChannels(); ++channel) {
+    sources[0] = block.getChannelPointer(channel);
+    for (size_t branch = 1; branch < numBranches; ++branch) {
+      sources[branch] =
+          getBranchBlock(branch, block).getChannelPointer(channel);
+    }
+    FusedKernels::mixBranches(block.getChannelPointer(channel), sources.data(),
+                              gains.data(), numBranches,
+                              block.getNumSamples());
+  }
+}
+
+template <typename SampleType>
+void DSP<SampleType>::DspChain::process(
+    juce::dsp::AudioBlock<SampleType> block) {
+  for (size_t first = 0; first < order.size();
+       first = order.getSectionEnd(first)) {
+    processSection(first, order.getSectionEnd(first), block);
+  }
+  delayOutput(block);
+}
+
+template <typename SampleType>
+void DSP<SampleType>::DspChain::delayOutput(
+    juce::dsp::AudioBlock<SampleType> block) {
+  if (padding == 0) {
+    return;
+  }
+
+  const auto length = static_cast<size_t>(outputHistory.getNumSamples());
+  const auto numSamples = block.getNumSamples();
+  const auto delay = static_cast<size_t>(padding);
+  jassert(numSamples + delay <= length);
+
+  // The block is recorded before it is read back delay samples late, the ring
+  // being long enough that it never overwrites what is read
+  const auto readPosition = (historyPosition + length - delay) % length;
+  const auto numToEnd = juce::jmin(numSamples, length - historyPosition);
+  const auto numReadToEnd = juce::jmin(numSamples, length - readPosition);
+  for (size_t channel = 0; channel < block.getNumChannels(); ++channel) {
+    auto *history = outputHistory.getWritePointer(static_cast<int>(channel));
+    auto *data = block.getChannelPointer(channel);
+
+    std::copy(data, data + numToEnd, history + historyPosition);
+    std::copy(data + numToEnd, data + numSamples, history);
+    std::copy(history + readPosition, history + readPosition + numReadToEnd,
+              data);
+    std::copy(history, history + (numSamples - numReadToEnd),
+              data + numReadToEnd);
+  }
+
+  historyPosition = (historyPosition + numSamples) % length;
+}
+
+template class DSP<float>;
+template class DSP<double>;
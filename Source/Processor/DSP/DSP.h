@@ -1,10 +1,15 @@
 #pragma once
 
+#include "../../Utils/Threading/WorkerPool.h"
 #include "../Parameters/Parameters.h"
+#include "../../Utils/Kernels/FusedKernels.h"
+#include "Drive.h"
+#include "StateVariableFilter.h"
 #include <JuceHeader.h>
 
-// Forward declaration
+// Forward declarations
 class PluginProcessor;
+class DspProfiler;
 
 enum class DspOption {
   Phase,
@@ -15,72 +20,348 @@ enum class DspOption {
   END_OF_LIST
 };
 
-enum FilterMode { Peak, Bandpass, Notch, Allpass, END_OF_LIST };
+constexpr size_t numDspOptions = static_cast<size_t>(DspOption::END_OF_LIST);
 
-using DspOrder =
-    std::array<DspOption, static_cast<size_t>(DspOption::END_OF_LIST)>;
+// Longest chain the slot pool is allocated for
+constexpr size_t maxChainLength = 8;
 
-class DSP {
+// How many times one effect can appear in a chain
+constexpr size_t maxInstancesPerOption = 4;
+
+// DSP ORDER
+//==============================================================================
+// The effects of a chain in processing order. An effect may appear more than
+// once: each appearance runs its own instance from the slot pool with its own
+// state, while every instance of an effect shares that effect's parameters.
+//
+// A slot marked parallel runs alongside the slot before it rather than after
+// it. A slot and the parallel ones following it form a section whose slots
+// are branches: each is fed the section's input, and the section's output is
+// the sum of the branches, each scaled by its branch gain.
+//
+// Orders are built on the message thread and handed to the audio thread
+// whole, so the capacity is fixed and copying one never allocates.
+class DspOrder {
+public:
+  // Phase, Chorus, OverDrive, LadderFilter, Filter
+  static DspOrder getDefault();
+
+  // False if the chain is full or the effect has used up its instances
+  bool canAdd(DspOption option) const;
+  bool insert(size_t index, DspOption option);
+  bool add(DspOption option) { return insert(length, option); }
+  void remove(size_t index);
+
+  size_t size() const { return length; }
+  bool empty() const { return length == 0; }
+  size_t count(DspOption option) const;
+
+  DspOption operator[](size_t index) const { return options[index]; }
+  const DspOption *begin() const { return options.data(); }
+  const DspOption *end() const { return options.data() + length; }
+
+  // The pool instance the slot at index runs, repeats of an effect count up
+  // from the front of the chain
+  size_t getInstance(size_t index) const { return instances[index]; }
+
+  // The first slot can't be parallel, there is nothing before it
+  void setParallel(size_t index, bool shouldBeParallel);
+  bool isParallel(size_t index) const { return parallel[index]; }
+
+  // Only used while the slot is a branch of a section
+  void setBranchGain(size_t index, float gain) { branchGains[index] = gain; }
+  float getBranchGain(size_t index) const { return branchGains[index]; }
+
+  // The slot after the end of the section starting at index
+  size_t getSectionEnd(size_t index) const;
+
+  bool operator==(const DspOrder &other) const;
+
+private:
+  void assignInstances();
+
+  std::array<DspOption, maxChainLength> options{};
+  std::array<size_t, maxChainLength> instances{};
+  std::array<bool, maxChainLength> parallel{};
+  std::array<float, maxChainLength> branchGains{};
+  size_t length = 0;
+};
+
+// Widest bus the processor accepts, a 7.1.4 bed
+constexpr int maxDspChannels = 12;
+
+// The signal an effect runs on while the chain is in M/S mode, in the order
+// of Parameters::Stereo::routings
+enum class MidSideRouting { Both, Mid, Side };
+
+// The chain is instantiated for float and double in DSP.cpp, the processor
+// runs whichever one matches the precision the host asked for
+template <typename SampleType> class DSP {
 public:
-  DSP(Parameters &params, juce::AudioProcessor &processor);
+  DSP(Parameters &params, DspProfiler &profiler, WorkerPool &workers);
+
+  // Parameters are pushed into the modules once every controlInterval samples
+  static constexpr int controlInterval = 32;
+
+  // Channels are processed in groups of one SIMD register's worth, each by
+  // its own chain
+  static constexpr size_t channelsPerGroup =
+      juce::jmax<size_t>(2, StateVariableFilter<SampleType>::numLanes);
+
+  // A new order fades in over transitionSeconds, see ORDER TRANSITIONS
+  static constexpr double transitionSeconds = 0.05;
 
   void prepareToPlay(const juce::dsp::ProcessSpec &spec);
-  void processBlock(juce::dsp::AudioBlock<float> leftBlock,
-                    juce::dsp::AudioBlock<float> rightBlock,
-                    const DspOrder &dspOrder);
+  void setDspOrder(const DspOrder &dspOrder);
+  void processBlock(juce::dsp::AudioBlock<SampleType> block);
+
+  // Groups are independent, so each is a job for the worker pool
+  size_t getNumChannelGroups() const { return chains.size(); }
 
-  juce::ReferenceCountedObjectPtr<juce::dsp::IIR::Coefficients<float>>
-  getFilterCoefficients() const {
-    return leftChannel.filter.dsp.coefficients;
+  // Latency of the whole chain, the sum of its Drive instances' oversampling
+  int getLatencySamples() const {
+    return chains.empty() ? 0 : chains.front()->getLatencySamples();
+  }
+
+  // How long the chain rings on once its input stops, estimated from the
+  // feedback, resonance and delay settings. Safe to call from any thread.
+  double getTailLengthSeconds() const {
+    return tailSeconds.load(std::memory_order_relaxed);
   }
 
 private:
   // HELPER TYPES
   //==============================================================================
-  template <typename DSP> struct DspChoice : juce::dsp::ProcessorBase {
-    void prepare(const juce::dsp::ProcessSpec &spec) override {
-      dsp.prepare(spec);
-    }
-    void
-    process(const juce::dsp::ProcessContextReplacing<float> &context) override {
-      dsp.process(context);
-    }
-    void reset() override { dsp.reset(); }
+  using ProcessContext = juce::dsp::ProcessContextReplacing<SampleType>;
 
-    DSP dsp;
+  // CONTROL VALUES
+  //==============================================================================
+  // Everything the chains read from the parameters, taken once per block so
+  // every channel group sees exactly the same values
+  struct BlockControls {
+    std::array<bool, numDspOptions> bypassed{}; // Indexed by DspOption
+    std::array<MidSideRouting, numDspOptions> routing{}; // Ditto
+    bool midSide = false;
+    int oversamplingOrder = 0;
+    int ladderFilterMode = 0;
+    int filterMode = 0;
   };
 
-  struct ProcessorState {
-    juce::dsp::ProcessorBase *processor = nullptr;
-    bool bypassed = false;
+  // The smoothed values for one control tick
+  struct TickControls {
+    std::array<float, Parameters::numSmoothedParameters> smoothed{};
+
+    float operator[](Parameters::SmoothedParameter parameter) const {
+      return smoothed[static_cast<size_t>(parameter)];
+    }
   };
 
-  using DspPointers =
-      std::array<ProcessorState, static_cast<size_t>(DspOption::END_OF_LIST)>;
+  BlockControls readBlockControls() const;
 
-  // DSP CHANNEL
+  // DSP CHAIN
   //==============================================================================
-  struct DspChannel {
-    DspChannel(Parameters &params, juce::AudioProcessor &processor);
+  // Processes every channel of a block in one pass. Each effect keeps the
+  // state of all channels side by side and shares its LFO, cutoff and
+  // coefficient math between them, so parameters are pushed once per block
+  // rather than once per channel.
+  //
+  // Each chain runs one channel group and is aligned to its own cache lines,
+  // so groups never share a line with each other.
+  //
+  // Every instance an order can ask for is allocated up front in a slot pool,
+  // so changing the order on the audio thread only picks other instances and
+  // resets the ones that join the chain. Each slot is dispatched through a
+  // table of processSlot instantiations, one per effect, and the order is run
+  // section by section, see DspOrder.
+  struct alignas(64) DspChain {
+    explicit DspChain(DspProfiler &profiler);
 
-    DspChoice<juce::dsp::Phaser<float>> phaser;
-    DspChoice<juce::dsp::Chorus<float>> chorus;
-    DspChoice<juce::dsp::LadderFilter<float>> overdrive, ladderFilter;
-    DspChoice<juce::dsp::IIR::Filter<float>> filter;
+    template <typename Processor>
+    using Pool = std::array<Processor, maxInstancesPerOption>;
 
-    void prepare(const juce::dsp::ProcessSpec &spec);
-    void update();
-    void process(juce::dsp::AudioBlock<float> block, const DspOrder &dspOrder);
+    Pool<juce::dsp::Phaser<SampleType>> phasers;
+    Pool<juce::dsp::Chorus<SampleType>> choruses;
+    Pool<Drive<SampleType>> overdrives;
+    Pool<juce::dsp::LadderFilter<SampleType>> ladderFilters;
+    Pool<StateVariableFilter<SampleType>> filters;
+
+    void prepare(const juce::dsp::ProcessSpec &spec,
+                 const BlockControls &controls);
+    void setDspOrder(const DspOrder &dspOrder);
+
+    // Takes up an order from scratch: every instance in it is reset and every
+    // slot starts in its current bypass state
+    void restart(const DspOrder &dspOrder, const BlockControls &controls);
+
+    // The order's latency plus any padding
+    int getLatencySamples() const;
+
+    // Delays the output on top of the order's own latency so the chain is
+    // latency samples late in all, see LATENCY PADDING. Only for a chain
+    // that has just been restarted and isn't being heard yet.
+    void padLatencyTo(int latency);
+    void clearLatencyPadding();
+    void updateBypassStates(const BlockControls &controls);
+
+    // Only the chain holding the mid and side channels routes its slots,
+    // every other one runs them on all of its channels
+    void updateRouting(const BlockControls &controls, bool holdsMidSide);
+    void update(const BlockControls &controls, const TickControls &tick);
+    void process(juce::dsp::AudioBlock<SampleType> block);
+
+    // While the chain fades in a new order it runs on a copy of each tick's
+    // input, one control tick long
+    juce::AudioBuffer<SampleType> transitionInput;
 
   private:
-    Parameters &parameters;
-    juce::AudioProcessor &processor;
+    using SlotFunction = void (DspChain::*)(size_t, const ProcessContext &);
+
+    // BYPASS
+    //==========================================================================
+    // Toggling a bypass crossfades between the slot's input and output over
+    // bypassFadeSeconds. Once faded out the processor is dormant: it is
+    // neither processed nor updated, and is reset when it fades back in.
+    static constexpr double bypassFadeSeconds = 0.01;
+
+    enum class SlotState { Active, FadingOut, Bypassed, FadingIn };
+
+    struct Slot {
+      SlotState state = SlotState::Active;
+      SampleType wetGain = 1;
+    };
+
+    template <DspOption Option> void updateBypassState(bool shouldBeBypassed);
+    void snapBypassStates(const BlockControls &controls);
+
+    // Instances in the current order that are not fully bypassed
+    template <DspOption Option, typename Function>
+    void forEachAwakeInstance(Function &&function);
+    void crossfade(Slot &slot,
+                   juce::dsp::AudioBlock<const SampleType> dryBlock,
+                   juce::dsp::AudioBlock<SampleType> wetBlock);
+
+    // PROCESSING
+    //==========================================================================
+
+    template <DspOption Option> auto &getProcessor(size_t instance);
+    template <DspOption Option>
+    void processSlot(size_t instance, const ProcessContext &context);
+    void processSlotAt(size_t index, const ProcessContext &context);
+    int getSlotLatency(size_t index) const;
+
+    // PARALLEL SECTIONS
+    //==========================================================================
+    // The first branch of a section runs in place, the others on copies of
+    // the section input in branchArena, one channel group's worth each. A
+    // branch with less latency than the section's slowest one is delayed to
+    // match before the branches are mixed together.
+    void processSection(size_t first, size_t end,
+                        juce::dsp::AudioBlock<SampleType> block);
+    juce::dsp::AudioBlock<SampleType>
+    getBranchBlock(size_t branch, juce::dsp::AudioBlock<SampleType> block);
+
+    juce::AudioBuffer<SampleType> branchArena;
+    std::array<juce::dsp::DelayLine<
+                   SampleType, juce::dsp::DelayLineInterpolationTypes::None>,
+               maxChainLength>
+        branchDelays; // Indexed by slot
+
+    // LATENCY PADDING
+    //==========================================================================
+    // Two chains crossfading between orders must be equally late or the mix
+    // combs. Only a chain that isn't being heard yet is padded, since a delay
+    // appearing under a playing chain would jump. A padded chain's output
+    // goes through a ring of its recent history, an unpadded one skips it.
+    int getOrderLatencySamples() const;
+    void delayOutput(juce::dsp::AudioBlock<SampleType> block);
+
+    juce::AudioBuffer<SampleType> outputHistory;
+    size_t historyPosition = 0;
+    int padding = 0, maxPadding = 0;
+
+    // Indexed by DspOption, then instance
+    template <typename Value>
+    using PerInstance =
+        std::array<std::array<Value, maxInstancesPerOption>, numDspOptions>;
+
+    DspProfiler &profiler;
+    DspOrder order;
+    PerInstance<Slot> slots{};
+    PerInstance<bool> inOrder{};
+    std::array<MidSideRouting, numDspOptions> routing{}; // By DspOption
+    juce::AudioBuffer<SampleType> dryBuffer;
+    SampleType fadeStep = 1;
     FilterMode cachedFilterMode = FilterMode::END_OF_LIST;
     float cachedFilterFreq = 0.f, cachedFilterQuality = 0.f,
           cachedFilterGain = -100.f;
   };
 
-  DspChannel leftChannel;
-  DspChannel rightChannel;
+  // CHANNEL GROUPS
+  //==============================================================================
+  // Runs every control tick of the block on one channel group
+  void processGroup(size_t groupIndex,
+                    juce::dsp::AudioBlock<SampleType> block);
+  void processChunk(juce::dsp::AudioBlock<SampleType> block);
+  static void processGroupJob(void *dsp, size_t groupIndex);
+
+  // ORDER TRANSITIONS
+  //==============================================================================
+  // A new order is not swapped in mid-stream, where the stateful effects would
+  // jump. Each group has a preallocated shadow chain which restarts on the new
+  // order and runs next to the outgoing chain on the same input, and the
+  // output crossfades from one to the other over transitionSeconds. The two
+  // then trade places and the old chain sits idle until the next change.
+  //
+  // At most one transition runs at a time, so an order change costs at most
+  // one extra chain per group for transitionSeconds. Orders arriving during a
+  // transition are queued, the latest one wins.
+  //
+  // An incoming order with less latency than the outgoing one is padded up to
+  // it for the fade, and the padding is held after it so the latency doesn't
+  // drop mid-stream. It is let go once the chain falls asleep. An incoming
+  // order with more latency can't be matched without delaying the chain that
+  // is playing, so the two fade across unaligned and the latency grows.
+  void beginTransition();
+  void crossfadeOrders(juce::dsp::AudioBlock<SampleType> outgoing,
+                       juce::dsp::AudioBlock<const SampleType> incoming,
+                       size_t offset) const;
+
+  // SILENCE
+  //==============================================================================
+  // Once the input has been silent for longer than the chain's tail plus its
+  // latency the chain goes to sleep: each chunk is cleared rather than
+  // processed until the input comes back. The tail is conservative, so the
+  // output has rung out below silenceThreshold by then and only the input is
+  // ever scanned. The smoothers keep running, so the controls are current
+  // when it wakes.
+  static constexpr SampleType silenceThreshold = SampleType(1.0e-5); // -100 dB
+  static constexpr double maxTailSeconds = 10.0;
+
+  double computeTailSeconds(const TickControls &tick) const;
+  static bool isSilent(juce::dsp::AudioBlock<const SampleType> block);
+  void sleepThroughChunk();
+
+  // One chain per channel group, allocated in prepareToPlay
+  std::vector<std::unique_ptr<DspChain>> chains;
+  std::vector<std::unique_ptr<DspChain>> shadowChains;
+  std::vector<TickControls> tickControls; // One per tick of the largest block
+  BlockControls blockControls;
+  DspOrder dspOrder;
+  DspOrder queuedOrder;
+  bool hasQueuedOrder = false;
+  bool transitioning = false;
+  size_t transitionLength = 1, transitionPosition = 0; // In samples
+  SampleType transitionStart = 0, transitionStep = 0;  // For the current chunk
+  juce::dsp::AudioBlock<SampleType> currentChunk; // Read by the group jobs
+  size_t numChannels = 0;
+  size_t maximumBlockSize = 0;
+  double sampleRate = 44100.0;
+
+  std::atomic<double> tailSeconds{0.0};
+  size_t silentSamples = 0;
+  bool asleep = false;
+
   Parameters &parameters;
+  DspProfiler &profiler;
+  WorkerPool &workers;
 };
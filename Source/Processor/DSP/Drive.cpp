@@ -0,0 +1,150 @@
+#include "Drive.h"
+
+namespace {
+// Padé approximation, only accurate inside +-5 where tanh has all but reached
+// +-1 anyway
+template <typename SampleType> SampleType fastTanh(SampleType x) {
+  return juce::dsp::FastMathApproximations::tanh(
+      juce::jlimit<SampleType>(-5, 5, x));
+}
+} // namespace
+
+template <typename SampleType>
+void Drive<SampleType>::prepare(const juce::dsp::ProcessSpec &spec) {
+  for (size_t i = 0; i < oversamplers.size(); ++i) {
+    oversamplers[i] = std::make_unique<juce::dsp::Oversampling<SampleType>>(
+        spec.numChannels, i + 1,
+        juce::dsp::Oversampling<SampleType>::filterHalfBandPolyphaseIIR, true,
+        true);
+    oversamplers[i]->initProcessing(spec.maximumBlockSize);
+    latencySamples[i + 1] =
+        juce::roundToInt(oversamplers[i]->getLatencyInSamples());
+  }
+
+  compensationDelay.setMaximumDelayInSamples(getMaxLatencySamples() + 1);
+  compensationDelay.prepare(spec);
+  compensationDelay.setDelay(static_cast<SampleType>(getLatencySamples()));
+
+  fadeBuffer.setSize(static_cast<int>(spec.numChannels),
+                     static_cast<int>(spec.maximumBlockSize));
+  fadeStep = static_cast<SampleType>(
+      1.0 / juce::jmax(1.0, factorFadeSeconds * spec.sampleRate));
+}
+
+template <typename SampleType> void Drive<SampleType>::reset() {
+  for (auto &oversampler : oversamplers) {
+    if (oversampler != nullptr) {
+      oversampler->reset();
+    }
+  }
+  currentDrive = targetDrive;
+
+  // Nothing is playing through the old factor, so there is nothing to fade
+  oversamplingOrder = requestedOrder;
+  fadeGain = 0;
+  compensationDelay.setDelay(static_cast<SampleType>(getLatencySamples()));
+}
+
+template <typename SampleType>
+void Drive<SampleType>::setOversamplingOrder(int newOrder) {
+  requestedOrder = juce::jlimit(0, maxOversamplingOrder, newOrder);
+}
+
+template <typename SampleType> void Drive<SampleType>::beginFactorFade() {
+  fadingOrder = oversamplingOrder;
+  fadeGain = 1;
+
+  // The reported latency moves to the new factor straight away. The factors'
+  // latencies differ by a few samples at most, too little to comb audibly
+  // over the length of the fade.
+  oversamplingOrder = requestedOrder;
+  if (oversamplingOrder > 0) {
+    oversamplers[static_cast<size_t>(oversamplingOrder - 1)]->reset();
+  }
+  compensationDelay.setDelay(static_cast<SampleType>(getLatencySamples()));
+}
+
+template <typename SampleType>
+void Drive<SampleType>::process(
+    const juce::dsp::ProcessContextReplacing<SampleType> &context) {
+  auto &block = context.getOutputBlock();
+  const auto fromDrive = currentDrive;
+  currentDrive = targetDrive;
+
+  // A change waits for the running fade to finish
+  if (fadeGain <= 0 && requestedOrder != oversamplingOrder) {
+    beginFactorFade();
+  }
+
+  if (fadeGain <= 0) {
+    processAtOrder(oversamplingOrder, block, fromDrive, targetDrive);
+    return;
+  }
+
+  const auto numSamples = block.getNumSamples();
+  auto fadeBlock = juce::dsp::AudioBlock<SampleType>(fadeBuffer)
+                       .getSubsetChannelBlock(0, block.getNumChannels())
+                       .getSubBlock(0, numSamples);
+  fadeBlock.copyFrom(block);
+  processAtOrder(fadingOrder, fadeBlock, fromDrive, targetDrive);
+  processAtOrder(oversamplingOrder, block, fromDrive, targetDrive);
+
+  for (size_t channel = 0; channel < block.getNumChannels(); ++channel) {
+    auto *data = block.getChannelPointer(channel);
+    const auto *outgoing = fadeBlock.getChannelPointer(channel);
+    auto gain = fadeGain;
+
+    for (size_t i = 0; i < numSamples; ++i) {
+      gain = juce::jmax(SampleType(0), gain - fadeStep);
+      data[i] += gain * (outgoing[i] - data[i]);
+    }
+  }
+
+  fadeGain = juce::jmax(
+      SampleType(0), fadeGain - fadeStep * static_cast<SampleType>(numSamples));
+}
+
+template <typename SampleType>
+void Drive<SampleType>::processAtOrder(int order,
+                                       juce::dsp::AudioBlock<SampleType> block,
+                                       SampleType fromDrive,
+                                       SampleType toDrive) {
+  if (order == 0) {
+    shape(block, fromDrive, toDrive);
+    return;
+  }
+
+  auto &oversampler = *oversamplers[static_cast<size_t>(order - 1)];
+  shape(oversampler.processSamplesUp(block), fromDrive, toDrive);
+  oversampler.processSamplesDown(block);
+}
+
+template <typename SampleType>
+void Drive<SampleType>::compensateLatency(
+    juce::dsp::AudioBlock<SampleType> block) {
+  if (getLatencySamples() > 0) {
+    compensationDelay.process(
+        juce::dsp::ProcessContextReplacing<SampleType>(block));
+  }
+}
+
+template <typename SampleType>
+void Drive<SampleType>::shape(juce::dsp::AudioBlock<SampleType> block,
+                              SampleType fromDrive, SampleType toDrive) {
+  const auto numSamples = block.getNumSamples();
+  const auto driveStep =
+      (toDrive - fromDrive) / static_cast<SampleType>(numSamples);
+
+  for (size_t channel = 0; channel < block.getNumChannels(); ++channel) {
+    auto *data = block.getChannelPointer(channel);
+    auto drive = fromDrive;
+
+    for (size_t i = 0; i < numSamples; ++i) {
+      drive += driveStep;
+      data[i] = fastTanh(drive * data[i]);
+    }
+  }
+}
+
+template class Drive<float>;
+template class Drive<double>;
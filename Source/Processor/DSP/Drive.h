@@ -0,0 +1,60 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// DRIVE
+//============================================================================
+// Tanh waveshaper run at 1x, 2x, 4x or 8x the host rate. Oversampling uses
+// JUCE's polyphase half-band IIR stages with integer latency, and every factor
+// is allocated in prepare() so switching between them on the audio thread is
+// just a matter of picking another one. A new factor is crossfaded in from the
+// old one over factorFadeSeconds rather than swapped, which would click.
+template <typename SampleType> class Drive {
+public:
+  static constexpr int maxOversamplingOrder = 3; // 2^3 = 8x
+  static constexpr double factorFadeSeconds = 0.01;
+
+  void prepare(const juce::dsp::ProcessSpec &spec);
+  void reset();
+  void process(const juce::dsp::ProcessContextReplacing<SampleType> &context);
+
+  // Ramped across the next processed block
+  void setDrive(SampleType newDrive) { targetDrive = newDrive; }
+
+  // 0 = 1x, 1 = 2x, 2 = 4x, 3 = 8x. Fades in from the next processed block,
+  // or takes over at once on the next reset().
+  void setOversamplingOrder(int newOrder);
+  int getLatencySamples() const {
+    return latencySamples[static_cast<size_t>(oversamplingOrder)];
+  }
+  int getMaxLatencySamples() const {
+    return *std::max_element(latencySamples.begin(), latencySamples.end());
+  }
+
+  // Delays a block by the current latency, so the signal stays aligned with
+  // the reported latency while the drive is bypassed
+  void compensateLatency(juce::dsp::AudioBlock<SampleType> block);
+
+private:
+  void beginFactorFade();
+  void processAtOrder(int order, juce::dsp::AudioBlock<SampleType> block,
+                      SampleType fromDrive, SampleType toDrive);
+  void shape(juce::dsp::AudioBlock<SampleType> block, SampleType fromDrive,
+             SampleType toDrive);
+
+  std::array<std::unique_ptr<juce::dsp::Oversampling<SampleType>>,
+             maxOversamplingOrder>
+      oversamplers; // Index is order - 1
+  std::array<int, maxOversamplingOrder + 1> latencySamples{};
+  juce::dsp::DelayLine<SampleType,
+                       juce::dsp::DelayLineInterpolationTypes::None>
+      compensationDelay;
+
+  int oversamplingOrder = 0, requestedOrder = 0;
+  SampleType currentDrive = 1, targetDrive = 1;
+
+  // The outgoing factor runs on a copy of the input until its gain reaches 0
+  juce::AudioBuffer<SampleType> fadeBuffer;
+  int fadingOrder = 0;
+  SampleType fadeGain = 0, fadeStep = 1;
+};
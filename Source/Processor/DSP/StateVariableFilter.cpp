@@ -0,0 +1,202 @@
+#include "StateVariableFilter.h"
+
+namespace {
+// tan(pi * f / fs) is tabulated up to just below Nyquist, where it diverges
+constexpr double maxNormalisedCutoff = 0.49;
+
+template <typename SampleType>
+SampleType lerp(SampleType start, SampleType end, SampleType amount) {
+  return start + (end - start) * amount;
+}
+} // namespace
+
+// COEFFICIENTS
+//==============================================================================
+template <typename SampleType>
+typename StateVariableFilter<SampleType>::Coefficients
+StateVariableFilter<SampleType>::Coefficients::make(FilterMode mode,
+                                                    SampleType quality,
+                                                    SampleType gainDecibels) {
+  const auto q = juce::jmax(SampleType(0.001), quality);
+
+  switch (mode) {
+  case FilterMode::Peak: {
+    const auto a = std::pow(SampleType(10), gainDecibels / SampleType(40));
+    const auto k = 1 / (q * a);
+    return {k, 1, k * (a * a - 1), 0};
+  }
+  case FilterMode::Bandpass:
+    return {1 / q, 0, 1 / q, 0};
+  case FilterMode::Notch:
+    return {1 / q, 1, -1 / q, 0};
+  case FilterMode::Allpass:
+    return {1 / q, 1, -2 / q, 0};
+  case FilterMode::END_OF_LIST:
+    break;
+  }
+
+  jassertfalse;
+  return {};
+}
+
+template <typename SampleType>
+double StateVariableFilter<SampleType>::Coefficients::getMagnitudeForFrequency(
+    double frequency, double cutoff, double sampleRate) const {
+  const auto maxFrequency = sampleRate * maxNormalisedCutoff;
+  const auto g = std::tan(juce::MathConstants<double>::pi *
+                          juce::jlimit(1.0, maxFrequency, cutoff) / sampleRate);
+  const auto s = std::complex<double>(
+      0.0, std::tan(juce::MathConstants<double>::pi *
+                    juce::jlimit(0.0, maxFrequency, frequency) / sampleRate) /
+               g);
+
+  const auto denominator = s * s + (double)k * s + 1.0;
+  return std::abs((double)m0 + ((double)m1 * s + (double)m2) / denominator);
+}
+
+// FILTER
+//==============================================================================
+template <typename SampleType>
+void StateVariableFilter<SampleType>::prepare(
+    const juce::dsp::ProcessSpec &spec) {
+  inverseSampleRate = static_cast<SampleType>(1.0 / spec.sampleRate);
+  tanTable.initialise(
+      [](SampleType x) {
+        return std::tan(juce::MathConstants<SampleType>::pi * x);
+      },
+      SampleType(0), static_cast<SampleType>(maxNormalisedCutoff), 2048);
+  state.resize((spec.numChannels + numLanes - 1) / numLanes);
+  reset();
+}
+
+template <typename SampleType> void StateVariableFilter<SampleType>::reset() {
+  std::fill(state.begin(), state.end(), GroupState{});
+  currentCutoff = targetCutoff;
+  current = target;
+}
+
+template <typename SampleType>
+void StateVariableFilter<SampleType>::setTarget(FilterMode mode,
+                                                SampleType cutoff,
+                                                SampleType quality,
+                                                SampleType gainDecibels) {
+  targetCutoff = cutoff;
+  target = Coefficients::make(mode, quality, gainDecibels);
+}
+
+template <typename SampleType>
+void StateVariableFilter<SampleType>::process(
+    const juce::dsp::ProcessContextReplacing<SampleType> &context) {
+  auto &block = context.getOutputBlock();
+  const auto numSamples = block.getNumSamples();
+  const auto rampStep =
+      1 / static_cast<SampleType>(juce::jmax<size_t>(1, numSamples));
+
+  for (size_t start = 0; start < numSamples; start += maxChunkSize) {
+    const auto chunkSize = juce::jmin(maxChunkSize, numSamples - start);
+    processChunk(block.getSubBlock(start, chunkSize),
+                 static_cast<SampleType>(start) * rampStep, rampStep);
+  }
+
+  currentCutoff = targetCutoff;
+  current = target;
+}
+
+template <typename SampleType>
+void StateVariableFilter<SampleType>::processChunk(
+    juce::dsp::AudioBlock<SampleType> block, SampleType rampStart,
+    SampleType rampStep) {
+  const auto numSamples = block.getNumSamples();
+  std::array<SampleType, maxChunkSize> a1{}, a2{}, a3{}, m0{}, m1{}, m2{};
+
+  // One set of per-sample coefficients, shared by every channel
+  for (size_t i = 0; i < numSamples; ++i) {
+    const auto amount = rampStart + static_cast<SampleType>(i + 1) * rampStep;
+    const auto cutoff = lerp(currentCutoff, targetCutoff, amount);
+    const auto k = lerp(current.k, target.k, amount);
+    const auto g = tanTable(cutoff * inverseSampleRate);
+
+    a1[i] = 1 / (1 + g * (g + k));
+    a2[i] = g * a1[i];
+    a3[i] = g * a2[i];
+    m0[i] = lerp(current.m0, target.m0, amount);
+    m1[i] = lerp(current.m1, target.m1, amount);
+    m2[i] = lerp(current.m2, target.m2, amount);
+  }
+
+  const auto numChannels =
+      juce::jmin(block.getNumChannels(), state.size() * numLanes);
+  alignas(sizeof(Vector)) std::array<SampleType, maxChunkSize * numLanes>
+      interleaved;
+
+  for (size_t group = 0; group * numLanes < numChannels; ++group) {
+    const auto firstChannel = group * numLanes;
+    const auto numGroupChannels =
+        juce::jmin(numLanes, numChannels - firstChannel);
+
+    // Lanes without a channel run on silence
+    if (numGroupChannels < numLanes) {
+      interleaved.fill(0);
+    }
+    for (size_t lane = 0; lane < numGroupChannels; ++lane) {
+      const auto *data = block.getChannelPointer(firstChannel + lane);
+      for (size_t i = 0; i < numSamples; ++i) {
+        interleaved[i * numLanes + lane] = data[i];
+      }
+    }
+
+    auto [ic1, ic2] = state[group];
+    for (size_t i = 0; i < numSamples; ++i) {
+      auto *frame = interleaved.data() + i * numLanes;
+      const auto v0 = load(frame);
+      const auto v3 = v0 - ic2;
+      const auto v1 = ic1 * a1[i] + v3 * a2[i];
+      const auto v2 = ic2 + ic1 * a2[i] + v3 * a3[i];
+      ic1 = v1 + v1 - ic1;
+      ic2 = v2 + v2 - ic2;
+      store(v0 * m0[i] + v1 * m1[i] + v2 * m2[i], frame);
+    }
+
+    for (size_t lane = 0; lane < numGroupChannels; ++lane) {
+      auto *data = block.getChannelPointer(firstChannel + lane);
+      for (size_t i = 0; i < numSamples; ++i) {
+        data[i] = interleaved[i * numLanes + lane];
+      }
+    }
+
+    state[group] = {snapToZero(ic1), snapToZero(ic2)};
+  }
+}
+
+template <typename SampleType>
+typename StateVariableFilter<SampleType>::Vector
+StateVariableFilter<SampleType>::load(const SampleType *source) {
+#if JUCE_USE_SIMD
+  return Vector::fromRawArray(source);
+#else
+  return *source;
+#endif
+}
+
+template <typename SampleType>
+void StateVariableFilter<SampleType>::store(Vector vector, SampleType *dest) {
+#if JUCE_USE_SIMD
+  vector.copyToRawArray(dest);
+#else
+  *dest = vector;
+#endif
+}
+
+template <typename SampleType>
+typename StateVariableFilter<SampleType>::Vector
+StateVariableFilter<SampleType>::snapToZero(Vector vector) {
+  alignas(sizeof(Vector)) std::array<SampleType, numLanes> lanes;
+  store(vector, lanes.data());
+  for (auto &lane : lanes) {
+    JUCE_SNAP_TO_ZERO(lane);
+  }
+  return load(lanes.data());
+}
+
+template class StateVariableFilter<float>;
+template class StateVariableFilter<double>;
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+enum FilterMode { Peak, Bandpass, Notch, Allpass, END_OF_LIST };
+
+// STATE VARIABLE FILTER
+//============================================================================
+// Topology-preserving transform (trapezoidal) SVF. Every mode is a mix of the
+// input, band and low outputs of the same core, so the filter stays stable
+// however fast it is modulated. Cutoff, damping and mix are ramped per
+// sample from the previous settings to the new ones across each processed
+// block; the per-sample cost of a new cutoff is one tan() table lookup.
+//
+// Channels are filtered numLanes at a time, one per SIMD lane: each chunk of
+// a group is interleaved into a register-aligned scratch block, run through
+// the core once and written back.
+template <typename SampleType> class StateVariableFilter {
+#if JUCE_USE_SIMD
+  using Vector = juce::dsp::SIMDRegister<SampleType>;
+#else
+  using Vector = SampleType;
+#endif
+
+public:
+  static constexpr size_t numLanes = sizeof(Vector) / sizeof(SampleType);
+
+  struct Coefficients {
+    // Damping (1 / Q) and the mix of the input, band and low outputs
+    SampleType k = 2;
+    SampleType m0 = 1, m1 = 0, m2 = 0;
+
+    static Coefficients make(FilterMode mode, SampleType quality,
+                             SampleType gainDecibels);
+
+    // Response of the analog prototype through the same prewarped bilinear
+    // transform the filter uses, for drawing the curve
+    double getMagnitudeForFrequency(double frequency, double cutoff,
+                                    double sampleRate) const;
+  };
+
+  void prepare(const juce::dsp::ProcessSpec &spec);
+  void reset();
+  void process(const juce::dsp::ProcessContextReplacing<SampleType> &context);
+
+  // Reached at the end of the next processed block
+  void setTarget(FilterMode mode, SampleType cutoff, SampleType quality,
+                 SampleType gainDecibels);
+
+private:
+  // State of numLanes channels
+  struct GroupState {
+    Vector ic1{}, ic2{};
+  };
+
+  // Per-sample coefficients are computed once per chunk for all channels
+  static constexpr size_t maxChunkSize = 32;
+
+  void processChunk(juce::dsp::AudioBlock<SampleType> block,
+                    SampleType rampStart, SampleType rampStep);
+  static Vector load(const SampleType *source);
+  static void store(Vector vector, SampleType *dest);
+  static Vector snapToZero(Vector vector);
+
+  juce::dsp::LookupTableTransform<SampleType> tanTable;
+  std::vector<GroupState> state;
+  SampleType inverseSampleRate = SampleType(1) / SampleType(44100);
+
+  SampleType currentCutoff = 1000, targetCutoff = 1000;
+  Coefficients current, target;
+};
@@ -27,8 +27,15 @@ Parameters::Parameters(juce::AudioProcessor &processor)
   };
 
   auto choiceParamInitializers = std::vector<ChoiceParamInitializer>{
+      {&overdriveOversampling, Overdrive::oversampling},
       {&ladderFilterMode, LadderFilter::mode},
       {&filterMode, Filter::mode},
+      {&phaserRouting, Phaser::routing},
+      {&chorusRouting, Chorus::routing},
+      {&overdriveRouting, Overdrive::routing},
+      {&ladderFilterRouting, LadderFilter::routing},
+      {&filterRouting, Filter::routing},
+      {&stereoMode, Stereo::mode},
   };
 
   auto boolParamInitializers = std::vector<BoolParamInitializer>{
@@ -43,26 +50,28 @@ Parameters::Parameters(juce::AudioProcessor &processor)
   initCachedChoiceParams(choiceParamInitializers);
   initCachedBoolParams(boolParamInitializers);
 
-  // Initialize parameter smoothers
-  paramSmootherPairs = {
-      {phaserRate, &phaserRateSmoother},
-      {phaserDepth, &phaserDepthSmoother},
-      {phaserCenterFreq, &phaserCenterFreqSmoother},
-      {phaserFeedback, &phaserFeedbackSmoother},
-      {phaserMix, &phaserMixSmoother},
-      {chorusRate, &chorusRateSmoother},
-      {chorusDepth, &chorusDepthSmoother},
-      {chorusCenterDelay, &chorusCenterDelaySmoother},
-      {chorusFeedback, &chorusFeedbackSmoother},
-      {chorusMix, &chorusMixSmoother},
-      {overdriveSaturation, &overdriveSaturationSmoother},
-      {ladderFilterCutoff, &ladderFilterCutoffSmoother},
-      {ladderFilterResonance, &ladderFilterResonanceSmoother},
-      {ladderFilterDrive, &ladderFilterDriveSmoother},
-      {filterFreq, &filterFreqSmoother},
-      {filterQuality, &filterQualitySmoother},
-      {filterGain, &filterGainSmoother},
+  // Initialize parameter smoothers, in SmoothedParameter order
+  smoothedParameters = {
+      phaserRate,
+      phaserDepth,
+      phaserCenterFreq,
+      phaserFeedback,
+      phaserMix,
+      chorusRate,
+      chorusDepth,
+      chorusCenterDelay,
+      chorusFeedback,
+      chorusMix,
+      overdriveSaturation,
+      ladderFilterCutoff,
+      ladderFilterResonance,
+      ladderFilterDrive,
+      filterFreq,
+      filterQuality,
+      filterGain,
   };
+  jassert(std::find(smoothedParameters.begin(), smoothedParameters.end(),
+                    nullptr) == smoothedParameters.end());
 }
 
 void Parameters::initCachedChoiceParams(
@@ -84,30 +93,26 @@ void Parameters::initCachedBoolParams(
 }
 
 void Parameters::prepareToPlay(double sampleRate) {
-  for (const auto &pair : paramSmootherPairs) {
-    pair.smoother->reset(sampleRate, 0.05);
-  }
-  updateSmoothers(1, SmootherUpdateMode::initialize);
+  smoothers.reset(sampleRate, 0.05);
+  updateSmoothers(SmootherUpdateMode::initialize);
 }
 
-void Parameters::updateSmoothers(int samplesToSkip,
-                                 SmootherUpdateMode smootherMode) {
-  for (const auto &pair : paramSmootherPairs) {
+void Parameters::updateSmoothers(SmootherUpdateMode smootherMode) {
+  for (size_t i = 0; i < smoothedParameters.size(); ++i) {
     if (smootherMode == SmootherUpdateMode::initialize) {
-      pair.smoother->setCurrentAndTargetValue(pair.param->get());
+      smoothers.setCurrentAndTargetValue(i, smoothedParameters[i]->get());
     } else {
-      pair.smoother->setTargetValue(pair.param->get());
+      smoothers.setTargetValue(i, smoothedParameters[i]->get());
     }
-    pair.smoother->skip(samplesToSkip);
   }
 }
 
 juce::AudioProcessorValueTreeState::ParameterLayout
 Parameters::createParameterLayout() {
   juce::AudioProcessorValueTreeState::ParameterLayout layout;
-  const int versionHint = 1;
 
   for (const auto &param : getAllParameters()) {
+    const auto versionHint = param.versionHint;
     if (param.type == ParameterType::Float) {
       layout.add(std::make_unique<juce::AudioParameterFloat>(
           juce::ParameterID{param.id, versionHint}, param.id,
@@ -117,7 +122,7 @@ Parameters::createParameterLayout() {
     } else if (param.type == ParameterType::Choice) {
       layout.add(std::make_unique<juce::AudioParameterChoice>(
           juce::ParameterID{param.id, versionHint}, param.displayName,
-          *param.choices, 0, ""));
+          *param.choices, static_cast<int>(param.defaultValue), ""));
     } else if (param.type == ParameterType::Bool) {
       layout.add(std::make_unique<juce::AudioParameterBool>(
           juce::ParameterID{param.id, versionHint}, param.id, false));
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "SmootherBank.h"
 #include <JuceHeader.h>
 
 enum class ParameterType { Float, Choice, Bool };
@@ -15,12 +16,36 @@ struct Parameter {
   float step = 0.01f;
   float skew = 1.f;
   const juce::StringArray *choices = nullptr;
+
+  // The plugin version that added the parameter. Hosts that address
+  // parameters by index see the ones added later after all of the older
+  // ones, see getAllParameters().
+  int versionHint = 1;
 };
 
 // STATIC PARAMETER DEFINITIONS
 //============================================================================
 class Parameters {
 public:
+  // Mid/side processing around the effect chain, see DSP
+  struct Stereo {
+    static inline const juce::StringArray modes{"L/R", "M/S"};
+
+    // Which of the mid and side signals an effect runs on in M/S mode,
+    // indexed by MidSideRouting
+    static inline const juce::StringArray routings{"Mid + Side", "Mid",
+                                                   "Side"};
+
+    static inline const Parameter mode = {.id = "Stereo Mode",
+                                          .displayName = "Stereo",
+                                          .suffix = "",
+                                          .type = ParameterType ::Choice,
+                                          .choices = &modes,
+                                          .versionHint = 2};
+
+    static inline const std::vector<Parameter> params = {mode};
+  };
+
   struct Phaser {
     static constexpr Parameter rate = {.id = "Phaser Rate",
                                        .displayName = "Rate",
@@ -59,13 +84,20 @@ public:
                                       .type = ParameterType ::Float,
                                       .defaultValue = 0.05f};
 
+    static inline const Parameter routing = {.id = "Phaser M/S Routing",
+                                             .displayName = "M/S",
+                                             .suffix = "",
+                                             .type = ParameterType ::Choice,
+                                             .choices = &Stereo::routings,
+                                             .versionHint = 2};
+
     static constexpr Parameter bypass = {.id = "Phaser Bypass",
                                          .displayName = "Bypass",
                                          .suffix = "",
                                          .type = ParameterType ::Bool};
 
     static inline const std::vector<Parameter> params = {
-        rate, depth, centerFreq, feedback, mix, bypass};
+        rate, depth, centerFreq, feedback, mix, bypass, routing};
   };
 
   struct Chorus {
@@ -103,13 +135,20 @@ public:
                                       .type = ParameterType ::Float,
                                       .defaultValue = 0.05f};
 
+    static inline const Parameter routing = {.id = "Chorus M/S Routing",
+                                             .displayName = "M/S",
+                                             .suffix = "",
+                                             .type = ParameterType ::Choice,
+                                             .choices = &Stereo::routings,
+                                             .versionHint = 2};
+
     static constexpr Parameter bypass = {.id = "Chorus Bypass",
                                          .displayName = "Bypass",
                                          .suffix = "",
                                          .type = ParameterType ::Bool};
 
     static inline const std::vector<Parameter> params = {
-        rate, depth, centerDelay, feedback, mix, bypass};
+        rate, depth, centerDelay, feedback, mix, bypass, routing};
   };
 
   struct Overdrive {
@@ -122,12 +161,33 @@ public:
                                              .defaultValue = 1.f,
                                              .step = 0.1f};
 
+    // Index is the oversampling order, see Drive
+    static inline const juce::StringArray oversamplingFactors{"1x", "2x", "4x",
+                                                              "8x"};
+
+    static inline const Parameter oversampling = {
+        .id = "Overdrive Oversampling",
+        .displayName = "Oversampling",
+        .suffix = "",
+        .type = ParameterType ::Choice,
+        .defaultValue = 1.f,
+        .choices = &oversamplingFactors,
+        .versionHint = 2};
+
+    static inline const Parameter routing = {.id = "Overdrive M/S Routing",
+                                             .displayName = "M/S",
+                                             .suffix = "",
+                                             .type = ParameterType ::Choice,
+                                             .choices = &Stereo::routings,
+                                             .versionHint = 2};
+
     static constexpr Parameter bypass = {.id = "Overdrive Bypass",
                                          .displayName = "Bypass",
                                          .suffix = "",
                                          .type = ParameterType ::Bool};
 
-    static inline const std::vector<Parameter> params = {saturation, bypass};
+    static inline const std::vector<Parameter> params = {
+        saturation, bypass, oversampling, routing};
   };
 
   struct LadderFilter {
@@ -165,13 +225,20 @@ public:
                                         .defaultValue = 1.f,
                                         .step = 0.1f};
 
+    static inline const Parameter routing = {.id = "Ladder Filter M/S Routing",
+                                             .displayName = "M/S",
+                                             .suffix = "",
+                                             .type = ParameterType ::Choice,
+                                             .choices = &Stereo::routings,
+                                             .versionHint = 2};
+
     static constexpr Parameter bypass = {.id = "Ladder Filter Bypass",
                                          .displayName = "Bypass",
                                          .suffix = "",
                                          .type = ParameterType ::Bool};
 
     static inline const std::vector<Parameter> params = {
-        mode, cutoff, resonance, drive, bypass};
+        mode, cutoff, resonance, drive, bypass, routing};
   };
 
   struct Filter {
@@ -212,13 +279,20 @@ public:
                                        .maxValue = 24.f,
                                        .step = 0.5f};
 
+    static inline const Parameter routing = {.id = "Filter M/S Routing",
+                                             .displayName = "M/S",
+                                             .suffix = "",
+                                             .type = ParameterType ::Choice,
+                                             .choices = &Stereo::routings,
+                                             .versionHint = 2};
+
     static constexpr Parameter bypass = {.id = "Filter Bypass",
                                          .displayName = "Bypass",
                                          .suffix = "",
                                          .type = ParameterType ::Bool};
 
-    static inline const std::vector<Parameter> params = {mode, freq, quality,
-                                                         gain, bypass};
+    static inline const std::vector<Parameter> params = {
+        mode, freq, quality, gain, bypass, routing};
   };
 
   struct Input {
@@ -261,6 +335,15 @@ public:
       allParameters.push_back(p);
     for (const auto &p : Output::params)
       allParameters.push_back(p);
+    for (const auto &p : Stereo::params)
+      allParameters.push_back(p);
+
+    // Each version's parameters go after every earlier version's, so the
+    // index of a parameter never changes once it has shipped
+    std::stable_sort(allParameters.begin(), allParameters.end(),
+                     [](const Parameter &a, const Parameter &b) {
+                       return a.versionHint < b.versionHint;
+                     });
     return allParameters;
   }
 
@@ -280,6 +363,7 @@ public:
   juce::AudioParameterFloat *phaserCenterFreq = nullptr;
   juce::AudioParameterFloat *phaserFeedback = nullptr;
   juce::AudioParameterFloat *phaserMix = nullptr;
+  juce::AudioParameterChoice *phaserRouting = nullptr;
   juce::AudioParameterBool *phaserBypass = nullptr;
   // Chorus
   juce::AudioParameterFloat *chorusRate = nullptr;
@@ -287,57 +371,79 @@ public:
   juce::AudioParameterFloat *chorusCenterDelay = nullptr;
   juce::AudioParameterFloat *chorusFeedback = nullptr;
   juce::AudioParameterFloat *chorusMix = nullptr;
+  juce::AudioParameterChoice *chorusRouting = nullptr;
   juce::AudioParameterBool *chorusBypass = nullptr;
   // Drive
   juce::AudioParameterFloat *overdriveSaturation = nullptr;
+  juce::AudioParameterChoice *overdriveOversampling = nullptr;
+  juce::AudioParameterChoice *overdriveRouting = nullptr;
   juce::AudioParameterBool *overdriveBypass = nullptr;
   // Ladder Filter
   juce::AudioParameterChoice *ladderFilterMode = nullptr;
   juce::AudioParameterFloat *ladderFilterCutoff = nullptr;
   juce::AudioParameterFloat *ladderFilterResonance = nullptr;
   juce::AudioParameterFloat *ladderFilterDrive = nullptr;
+  juce::AudioParameterChoice *ladderFilterRouting = nullptr;
   juce::AudioParameterBool *ladderFilterBypass = nullptr;
   // Filter
   juce::AudioParameterChoice *filterMode = nullptr;
   juce::AudioParameterFloat *filterFreq = nullptr;
   juce::AudioParameterFloat *filterQuality = nullptr;
   juce::AudioParameterFloat *filterGain = nullptr;
+  juce::AudioParameterChoice *filterRouting = nullptr;
   juce::AudioParameterBool *filterBypass = nullptr;
   // Input Gain
   juce::AudioParameterFloat *inputGain = nullptr;
   // Output Gain
   juce::AudioParameterFloat *outputGain = nullptr;
+  // Stereo
+  juce::AudioParameterChoice *stereoMode = nullptr;
 
   // SMOOTHED VALUES
   //============================================================================
-  // Phaser
-  juce::SmoothedValue<float> phaserRateSmoother;
-  juce::SmoothedValue<float> phaserDepthSmoother;
-  juce::SmoothedValue<float> phaserCenterFreqSmoother;
-  juce::SmoothedValue<float> phaserFeedbackSmoother;
-  juce::SmoothedValue<float> phaserMixSmoother;
-  // Chorus
-  juce::SmoothedValue<float> chorusRateSmoother;
-  juce::SmoothedValue<float> chorusDepthSmoother;
-  juce::SmoothedValue<float> chorusCenterDelaySmoother;
-  juce::SmoothedValue<float> chorusFeedbackSmoother;
-  juce::SmoothedValue<float> chorusMixSmoother;
-  // Drive
-  juce::SmoothedValue<float> overdriveSaturationSmoother;
-  // Ladder Filter
-  juce::SmoothedValue<float> ladderFilterCutoffSmoother;
-  juce::SmoothedValue<float> ladderFilterResonanceSmoother;
-  juce::SmoothedValue<float> ladderFilterDriveSmoother;
-  // Filter
-  juce::SmoothedValue<float> filterFreqSmoother;
-  juce::SmoothedValue<float> filterQualitySmoother;
-  juce::SmoothedValue<float> filterGainSmoother;
+  enum class SmoothedParameter {
+    // Phaser
+    PhaserRate,
+    PhaserDepth,
+    PhaserCenterFreq,
+    PhaserFeedback,
+    PhaserMix,
+    // Chorus
+    ChorusRate,
+    ChorusDepth,
+    ChorusCenterDelay,
+    ChorusFeedback,
+    ChorusMix,
+    // Drive
+    OverdriveSaturation,
+    // Ladder Filter
+    LadderFilterCutoff,
+    LadderFilterResonance,
+    LadderFilterDrive,
+    // Filter
+    FilterFreq,
+    FilterQuality,
+    FilterGain,
+    END_OF_LIST
+  };
+
+  static constexpr size_t numSmoothedParameters =
+      static_cast<size_t>(SmoothedParameter::END_OF_LIST);
+
+  float getSmoothedValue(SmoothedParameter parameter) const {
+    return smoothers.getCurrentValue(static_cast<size_t>(parameter));
+  }
 
   // PARAMETER MANAGEMENT
   //============================================================================
   void prepareToPlay(double sampleRate);
   enum class SmootherUpdateMode { initialize, updateExisting };
-  void updateSmoothers(int samplesToSkip, SmootherUpdateMode smootherMode);
+
+  // Pull the latest parameter values in as smoother targets, once per block
+  void updateSmoothers(SmootherUpdateMode smootherMode);
+
+  // Move every smoother forward by one control tick
+  void advanceSmoothers(int numSamples) { smoothers.advance(numSamples); }
 
   static juce::AudioProcessorValueTreeState::ParameterLayout
   createParameterLayout();
@@ -376,9 +482,7 @@ private:
 
   // PARAMETER SMOOTHING
   //============================================================================
-  struct ParamSmootherPair {
-    juce::AudioParameterFloat *param;
-    juce::SmoothedValue<float> *smoother;
-  };
-  std::vector<ParamSmootherPair> paramSmootherPairs;
+  SmootherBank<numSmoothedParameters> smoothers;
+  std::array<juce::AudioParameterFloat *, numSmoothedParameters>
+      smoothedParameters{};
 };
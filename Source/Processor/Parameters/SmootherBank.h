@@ -0,0 +1,54 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// SMOOTHER BANK
+//============================================================================
+// A set of linear smoothers stored as a structure of arrays. advance() moves
+// every smoother forward in a single branch-free loop over contiguous arrays
+// which the compiler can vectorise, so the cost per control tick is constant
+// no matter how many smoothers are ramping.
+template <size_t NumSmoothers> class SmootherBank {
+public:
+  void reset(double sampleRate, double rampLengthSeconds) {
+    rampLengthInSamples =
+        juce::jmax(1.0f, std::floor((float)(rampLengthSeconds * sampleRate)));
+    for (size_t i = 0; i < NumSmoothers; ++i) {
+      setCurrentAndTargetValue(i, target[i]);
+    }
+  }
+
+  void setCurrentAndTargetValue(size_t index, float value) {
+    current[index] = target[index] = value;
+    step[index] = 0.0f;
+    remaining[index] = 0.0f;
+  }
+
+  void setTargetValue(size_t index, float value) {
+    if (value == target[index]) {
+      return;
+    }
+    target[index] = value;
+    remaining[index] = rampLengthInSamples;
+    step[index] = (value - current[index]) / rampLengthInSamples;
+  }
+
+  void advance(int numSamples) {
+    const auto samples = static_cast<float>(numSamples);
+    for (size_t i = 0; i < NumSmoothers; ++i) {
+      const auto stepsTaken = juce::jmin(samples, remaining[i]);
+      remaining[i] -= stepsTaken;
+      current[i] =
+          remaining[i] > 0.0f ? current[i] + step[i] * stepsTaken : target[i];
+    }
+  }
+
+  float getCurrentValue(size_t index) const { return current[index]; }
+
+private:
+  alignas(16) std::array<float, NumSmoothers> current{};
+  alignas(16) std::array<float, NumSmoothers> target{};
+  alignas(16) std::array<float, NumSmoothers> step{};
+  alignas(16) std::array<float, NumSmoothers> remaining{};
+  float rampLengthInSamples = 1.0f;
+};
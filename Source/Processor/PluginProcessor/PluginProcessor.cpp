@@ -1,5 +1,7 @@
 #include "PluginProcessor.h"
+#if !MULTI_EFFECT_HEADLESS
 #include "../../GUI/PluginEditor/PluginEditor.h"
+#endif
 
 // DSP OPTIONS
 //==============================================================================
@@ -43,25 +45,22 @@ PluginProcessor::PluginProcessor()
 #else
     :
 #endif
-      parameters(*this), dsp(parameters, *this) {
-
-  for (size_t i = 0; i < dspOrder.size(); ++i) {
-    dspOrder[i] = static_cast<DspOption>(i);
-  }
+      parameters(*this), floatDsp(parameters, profiler, workers),
+      doubleDsp(parameters, profiler, workers) {
 
   // Initialize DSP order in ValueTree if it doesn't exist
   if (!parameters.apvts.state.getChildWithName("DspOrder").isValid()) {
-    juce::ValueTree dspOrderTree("DspOrder");
-    for (int i = 0; i < static_cast<int>(DspOption::END_OF_LIST); ++i) {
-      auto dspOption = static_cast<DspOption>(i);
-      dspOrderTree.setProperty("Position_" + juce::String(i),
-                               getDspNameFromOption(dspOption), nullptr);
-    }
-    parameters.apvts.state.appendChild(dspOrderTree, nullptr);
+    saveDspOrderToState(DspOrder::getDefault());
   }
+
+  startTimerHz(latencyPollHz);
 }
 
-PluginProcessor::~PluginProcessor() {}
+PluginProcessor::~PluginProcessor() {
+  stopTimer();
+  delete pendingDspOrder.exchange(nullptr);
+  reclaimRetiredDspOrders();
+}
 
 // PLUGIN INFO
 //==============================================================================
@@ -91,7 +90,10 @@ bool PluginProcessor::isMidiEffect() const {
 #endif
 }
 
-double PluginProcessor::getTailLengthSeconds() const { return 0.0; }
+double PluginProcessor::getTailLengthSeconds() const {
+  return isUsingDoublePrecision() ? doubleDsp.getTailLengthSeconds()
+                                  : floatDsp.getTailLengthSeconds();
+}
 
 // PROGRAMS
 //==============================================================================
@@ -113,28 +115,49 @@ void PluginProcessor::changeProgramName(int index,
 // PREPARE / RELEASE CONFIG
 //==============================================================================
 void PluginProcessor::prepareToPlay(double sampleRate, int samplesPerBlock) {
+  // Take a pending order now so the latency reported below already covers it
+  applyPendingDspOrder();
 
   juce::dsp::ProcessSpec spec;
   spec.sampleRate = sampleRate;
   spec.maximumBlockSize = samplesPerBlock;
+  spec.numChannels = static_cast<juce::uint32>(
+      juce::jmax(getTotalNumInputChannels(), getTotalNumOutputChannels()));
 
-  spec.numChannels = 1;
-  dsp.prepareToPlay(spec);
+  // Only the chain matching the host's precision is allocated and run
+  if (isUsingDoublePrecision()) {
+    doubleDsp.prepareToPlay(spec);
+  } else {
+    floatDsp.prepareToPlay(spec);
+  }
+  inputGain.reset(sampleRate, 0.05);
+  outputGain.reset(sampleRate, 0.05);
+  inputGain.setCurrentAndTargetValue(
+      juce::Decibels::decibelsToGain(parameters.inputGain->get()));
+  outputGain.setCurrentAndTargetValue(
+      juce::Decibels::decibelsToGain(parameters.outputGain->get()));
+
+  // Both hold one run of the output stage, see processBlockInternal. The
+  // double mix is sized even for a float host, so a block in the other
+  // precision can never run past it.
+  samplesForAnalyzer.resize(
+      static_cast<size_t>(juce::jmax(1, samplesPerBlock)));
+  doubleSamplesForAnalyzer.resize(samplesForAnalyzer.size());
 
-  spec.numChannels = 2;
-  inputGain.prepare(spec);
-  outputGain.prepare(spec);
-  inputGain.setRampDurationSeconds(0.05);
-  outputGain.setRampDurationSeconds(0.05);
+  parameters.prepareToPlay(sampleRate);
 
-  samplesForAnalyzer.resize(samplesPerBlock);
+  dspLatency.store(getDspLatencySamples());
+  setLatencySamples(dspLatency.load());
 
-  parameters.prepareToPlay(sampleRate);
+  // Threads are only started and stopped while the audio thread is, parked
+  // until multi-core processing is switched on
+  workers.start(getNumUsableWorkers(), samplesPerBlock, sampleRate);
+  updateWorkers();
 }
 
 void PluginProcessor::releaseResources() {
-  // When playback stops, you can use this as an opportunity to free up any
-  // spare memory, etc.
+  // Workers are started again by the next prepareToPlay
+  workers.stop();
 }
 
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -143,12 +166,10 @@ bool PluginProcessor::isBusesLayoutSupported(const BusesLayout &layouts) const {
   juce::ignoreUnused(layouts);
   return true;
 #else
-  // This is the place where you check if the layout is supported.
-  // In this template code we only support mono or stereo.
-  // Some plugin hosts, such as certain GarageBand versions, will only
-  // load plugins that support stereo bus layouts.
-  if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono() &&
-      layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
+  // Anything from mono up to a 7.1.4 bed, the DSP splits the bus into
+  // channel groups however wide it is
+  const auto &mainOutput = layouts.getMainOutputChannelSet();
+  if (mainOutput.isDisabled() || mainOutput.size() > maxDspChannels)
     return false;
 
 #if !JucePlugin_IsSynth
@@ -164,62 +185,181 @@ bool PluginProcessor::isBusesLayoutSupported(const BusesLayout &layouts) const {
 
 void PluginProcessor::processBlock(juce::AudioBuffer<float> &buffer,
                                    juce::MidiBuffer &midiMessages) {
-  juce::ScopedNoDenormals noDenormals;
-  auto totalNumInputChannels = getTotalNumInputChannels();
-  auto totalNumOutputChannels = getTotalNumOutputChannels();
-  auto block = juce::dsp::AudioBlock<float>(buffer);
-
-  // Update DSP order
-  DspOrder newDspOrder;
-  while (dspOrderFifo.pull(newDspOrder)) {
-    dspOrder = newDspOrder;
+  processBlockInternal(buffer);
+}
+
+void PluginProcessor::processBlock(juce::AudioBuffer<double> &buffer,
+                                   juce::MidiBuffer &midiMessages) {
+  processBlockInternal(buffer);
+}
+
+template <typename SampleType> DSP<SampleType> &PluginProcessor::getDsp() {
+  if constexpr (std::is_same_v<SampleType, double>) {
+    return doubleDsp;
+  } else {
+    return floatDsp;
   }
+}
+
+int PluginProcessor::getDspLatencySamples() {
+  return isUsingDoublePrecision() ? doubleDsp.getLatencySamples()
+                                  : floatDsp.getLatencySamples();
+}
 
-  // Input Gain
-  inputGain.setGainDecibels(parameters.inputGain->get());
-  inputGain.process(juce::dsp::ProcessContextReplacing<float>(block));
+template <typename SampleType>
+void PluginProcessor::processBlockInternal(
+    juce::AudioBuffer<SampleType> &buffer) {
+  juce::ScopedNoDenormals noDenormals;
+  const auto blockStart = DspProfiler::now();
+  auto &dsp = getDsp<SampleType>();
+  auto block = juce::dsp::AudioBlock<SampleType>(buffer);
+  int numSamples = buffer.getNumSamples();
 
-  // Input Meter
-  float inputRmsLeft = buffer.getRMSLevel(0, 0, buffer.getNumSamples());
-  float inputRmsRight = buffer.getRMSLevel(1, 0, buffer.getNumSamples());
-  inputLevelFifo.push({inputRmsLeft, inputRmsRight});
+  applyPendingDspOrder();
+
+  // Input Gain + Meter
+  {
+    DspProfiler::ScopedStageTimer timer(profiler,
+                                        DspProfiler::Stage::GainAndMeters);
+    inputLevelFifo.push(
+        processGainStage(buffer, inputGain, parameters.inputGain->get()));
+  }
 
   // Update Smoothers
-  parameters.updateSmoothers(buffer.getNumSamples(),
-                             Parameters::SmootherUpdateMode::updateExisting);
+  {
+    DspProfiler::ScopedStageTimer timer(profiler,
+                                        DspProfiler::Stage::Parameters);
+    parameters.updateSmoothers(Parameters::SmootherUpdateMode::updateExisting);
+  }
 
   // Process
-  auto leftBlock = block.getSingleChannelBlock(0);
-  auto rightBlock = block.getSingleChannelBlock(1);
-  dsp.processBlock(leftBlock, rightBlock, dspOrder);
+  dsp.processBlock(block);
+
+  // Changing the Drive oversampling factor or the number of Drives in the
+  // order changes the latency, see LATENCY
+  dspLatency.store(dsp.getLatencySamples(), std::memory_order_relaxed);
+
+  // Output Gain + Meter + Analyzer mono mix, in runs no longer than the
+  // analyzer buffers. Hosts may pass blocks bigger than the samplesPerBlock
+  // they were sized for in prepareToPlay.
+  SampleType *analyzerMix;
+  if constexpr (std::is_same_v<SampleType, double>) {
+    analyzerMix = doubleSamplesForAnalyzer.data();
+  } else {
+    analyzerMix = samplesForAnalyzer.data();
+  }
+  const auto maxRunLength = static_cast<int>(samplesForAnalyzer.size());
+
+  MeterLevels outputLevels;
+  for (int runStart = 0; runStart < numSamples; runStart += maxRunLength) {
+    const auto runLength = juce::jmin(maxRunLength, numSamples - runStart);
+    juce::AudioBuffer<SampleType> run(buffer.getArrayOfWritePointers(),
+                                      buffer.getNumChannels(), runStart,
+                                      runLength);
+    {
+      DspProfiler::ScopedStageTimer timer(profiler,
+                                          DspProfiler::Stage::GainAndMeters);
+      const auto runLevels = processGainStage(
+          run, outputGain, parameters.outputGain->get(), analyzerMix);
+
+      // The block's rms is the runs' mean square weighted by their length
+      const auto runWeight = static_cast<float>(runLength) / numSamples;
+      for (size_t meter = 0; meter < outputLevels.rms.size(); ++meter) {
+        outputLevels.rms[meter] += runLevels.rms[meter] *
+                                   runLevels.rms[meter] * runWeight;
+        outputLevels.peak[meter] =
+            juce::jmax(outputLevels.peak[meter], runLevels.peak[meter]);
+      }
+    }
 
-  // Output Gain
-  outputGain.setGainDecibels(parameters.outputGain->get());
-  outputGain.process(juce::dsp::ProcessContextReplacing<float>(block));
+    // Spectrum Analyzer
+    {
+      DspProfiler::ScopedStageTimer timer(profiler,
+                                          DspProfiler::Stage::Analyzer);
+      if constexpr (std::is_same_v<SampleType, double>) {
+        std::transform(
+            doubleSamplesForAnalyzer.begin(),
+            doubleSamplesForAnalyzer.begin() + runLength,
+            samplesForAnalyzer.begin(),
+            [](double sample) { return static_cast<float>(sample); });
+      }
+      analyzerFifo.write(samplesForAnalyzer.data(),
+                         static_cast<size_t>(runLength));
+    }
+  }
 
-  // Output Meter
-  float outputRmsLeft = buffer.getRMSLevel(0, 0, buffer.getNumSamples());
-  float outputRmsRight = buffer.getRMSLevel(1, 0, buffer.getNumSamples());
-  outputLevelFifo.push({outputRmsLeft, outputRmsRight});
+  for (auto &rms : outputLevels.rms) {
+    rms = std::sqrt(rms);
+  }
+  outputLevelFifo.push(outputLevels);
 
-  // Spectrum Analyzer
-  int numSamples = buffer.getNumSamples();
-  for (int i = 0; i < numSamples; ++i) {
-    samplesForAnalyzer[i] =
-        (buffer.getSample(0, i) + buffer.getSample(1, i)) * 0.5f;
+  if (profiler.isEnabled()) {
+    profiler.addBlock(DspProfiler::now() - blockStart, numSamples,
+                      getSampleRate());
+  }
+}
+
+template <typename SampleType>
+MeterLevels
+PluginProcessor::processGainStage(juce::AudioBuffer<SampleType> &buffer,
+                                  juce::SmoothedValue<float> &gain,
+                                  float gainDecibels, SampleType *mono) {
+  MeterLevels levels;
+  const auto numChannels = buffer.getNumChannels();
+  const auto numSamples = buffer.getNumSamples();
+  if (numChannels == 0 || numSamples == 0) {
+    return levels;
   }
-  analyzerFifo.push(samplesForAnalyzer);
+
+  // The ramp SmoothedValue would produce over this block, as start + step
+  gain.setTargetValue(juce::Decibels::decibelsToGain(gainDecibels));
+  const auto startGain = static_cast<SampleType>(gain.getCurrentValue());
+  const auto gainStep =
+      (static_cast<SampleType>(gain.skip(numSamples)) - startGain) /
+      numSamples;
+
+  for (int channel = 0; channel < numChannels; ++channel) {
+    auto channelLevels = FusedKernels::applyGainAndMeasure(
+        buffer.getWritePointer(channel), static_cast<size_t>(numSamples),
+        startGain + gainStep, gainStep, mono,
+        static_cast<SampleType>(1) / numChannels, channel > 0);
+
+    // Wider buses fold onto the two meters, even channels on the left and
+    // odd ones on the right, each meter showing its loudest channel
+    const auto meter = static_cast<size_t>(channel) % levels.rms.size();
+    levels.rms[meter] = juce::jmax(
+        levels.rms[meter],
+        static_cast<float>(std::sqrt(channelLevels.sumOfSquares / numSamples)));
+    levels.peak[meter] =
+        juce::jmax(levels.peak[meter], static_cast<float>(channelLevels.peak));
+  }
+
+  // A mono bus shows the same level on both meters
+  if (numChannels == 1) {
+    levels.rms[1] = levels.rms[0];
+    levels.peak[1] = levels.peak[0];
+  }
+
+  return levels;
 }
 
 // EDITOR
 //==============================================================================
 bool PluginProcessor::hasEditor() const {
+#if MULTI_EFFECT_HEADLESS
+  return false; // Offline tools build without the GUI sources
+#else
   return true; // (change this to false if you choose to not supply an editor)
+#endif
 }
 
 juce::AudioProcessorEditor *PluginProcessor::createEditor() {
+#if MULTI_EFFECT_HEADLESS
+  return nullptr;
+#else
   return new PluginEditor(*this);
   // return new juce::GenericAudioProcessorEditor(*this);
+#endif
 }
 
 // STATE SAVING METHODS
@@ -231,9 +371,22 @@ void PluginProcessor::saveDspOrderToState(const DspOrder &order) {
     parameters.apvts.state.appendChild(dspOrderTree, nullptr);
   }
 
-  for (int i = 0; i < order.size(); ++i) {
-    dspOrderTree.setProperty("Position_" + juce::String(i),
-                             getDspNameFromOption(order[i]), nullptr);
+  // Positions past the end of a shorter order are removed, so the length is
+  // wherever they stop
+  for (size_t i = 0; i < maxChainLength; ++i) {
+    auto position = "Position_" + juce::String(i);
+    auto parallel = "Parallel_" + juce::String(i);
+    auto gain = "Gain_" + juce::String(i);
+    if (i < order.size()) {
+      dspOrderTree.setProperty(position, getDspNameFromOption(order[i]),
+                               nullptr);
+      dspOrderTree.setProperty(parallel, order.isParallel(i), nullptr);
+      dspOrderTree.setProperty(gain, order.getBranchGain(i), nullptr);
+    } else {
+      dspOrderTree.removeProperty(position, nullptr);
+      dspOrderTree.removeProperty(parallel, nullptr);
+      dspOrderTree.removeProperty(gain, nullptr);
+    }
   }
 }
 
@@ -241,19 +394,45 @@ DspOrder PluginProcessor::getDspOrderFromState() const {
   DspOrder order;
   auto dspOrderTree = parameters.apvts.state.getChildWithName("DspOrder");
 
-  if (!dspOrderTree.isValid()) {
-    for (int i = 0; i < order.size(); ++i) {
-      order[i] = static_cast<DspOption>(i);
-    }
-  } else {
-    for (int i = 0; i < order.size(); ++i) {
-      juce::String name =
-          dspOrderTree.getProperty("Position_" + juce::String(i));
-      order[i] = getDspOptionFromName(name);
+  for (size_t i = 0; dspOrderTree.isValid() && i < maxChainLength; ++i) {
+    juce::String name = dspOrderTree.getProperty("Position_" + juce::String(i));
+    if (!order.add(getDspOptionFromName(name))) {
+      break;
     }
+    order.setParallel(i, dspOrderTree.getProperty(
+                             "Parallel_" + juce::String(i), false));
+    order.setBranchGain(
+        i, dspOrderTree.getProperty("Gain_" + juce::String(i), 1.f));
   }
 
-  return order;
+  return order.empty() ? DspOrder::getDefault() : order;
+}
+
+void PluginProcessor::publishDspOrder(const DspOrder &order) {
+  // An order the audio thread never took is still ours to delete
+  delete pendingDspOrder.exchange(new DspOrder(order));
+}
+
+void PluginProcessor::applyPendingDspOrder() {
+  // With the retire queue full the swap waits for a later block rather than
+  // delete the old order here
+  if (retiredDspOrders.isFull()) {
+    return;
+  }
+
+  if (auto *newDspOrder = pendingDspOrder.exchange(nullptr)) {
+    // Both chains follow it so switching precision keeps it
+    floatDsp.setDspOrder(*newDspOrder);
+    doubleDsp.setDspOrder(*newDspOrder);
+    retiredDspOrders.push(newDspOrder);
+  }
+}
+
+void PluginProcessor::reclaimRetiredDspOrders() {
+  DspOrder *retired = nullptr;
+  while (retiredDspOrders.pull(retired)) {
+    delete retired;
+  }
 }
 
 void PluginProcessor::saveSelectedTabToState(const DspOption &selectedTab) {
@@ -272,6 +451,45 @@ DspOption PluginProcessor::getSelectedTabFromState() const {
   }
 }
 
+// MULTI-CORE
+//==============================================================================
+void PluginProcessor::setMultiCoreEnabled(bool shouldBeEnabled) {
+  parameters.apvts.state.setProperty("MultiCore", shouldBeEnabled, nullptr);
+  updateWorkers();
+}
+
+bool PluginProcessor::isMultiCoreEnabled() const {
+  return parameters.apvts.state.getProperty("MultiCore", false);
+}
+
+int PluginProcessor::getNumUsableWorkers() const {
+  // One group always runs on the audio thread, the rest can go to workers as
+  // long as there are spare cores for them
+  const auto numGroups = static_cast<int>(
+      isUsingDoublePrecision() ? doubleDsp.getNumChannelGroups()
+                               : floatDsp.getNumChannelGroups());
+  return juce::jmax(
+      0, juce::jmin(numGroups - 1, juce::SystemStats::getNumCpus() - 1));
+}
+
+void PluginProcessor::updateWorkers() {
+  // Only parks or unparks the threads prepareToPlay started, so this is safe
+  // from a host thread while the audio thread is running
+  workers.setNumActiveWorkers(isMultiCoreEnabled() ? getNumUsableWorkers()
+                                                   : 0);
+}
+
+// LATENCY
+//==============================================================================
+void PluginProcessor::timerCallback() {
+  reclaimRetiredDspOrders();
+
+  const auto latency = dspLatency.load(std::memory_order_relaxed);
+  if (latency != getLatencySamples()) {
+    setLatencySamples(latency);
+  }
+}
+
 // STATE MANAGEMENT
 //==============================================================================
 void PluginProcessor::getStateInformation(juce::MemoryBlock &destData) {
@@ -284,8 +502,8 @@ void PluginProcessor::setStateInformation(const void *data, int sizeInBytes) {
   if (tree.isValid()) {
     parameters.apvts.replaceState(tree);
 
-    auto order = getDspOrderFromState();
-    dspOrderFifo.push(order);
+    publishDspOrder(getDspOrderFromState());
+    updateWorkers();
   }
 }
 
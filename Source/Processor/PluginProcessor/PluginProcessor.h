@@ -3,13 +3,16 @@
 #include "../../Utils/Fifos/DspOrderFifo.h"
 #include "../../Utils/Fifos/AudioMeterFifo.h"
 #include "../../Utils/Fifos/SpectrumAnalyzerFifo.h"
+#include "../../Utils/Kernels/FusedKernels.h"
+#include "../../Utils/Profiling/DspProfiler.h"
 #include "../DSP/DSP.h"
 #include "../Parameters/Parameters.h"
 #include <JuceHeader.h>
 
 // AUDIO PROCESSOR
 //==============================================================================
-class PluginProcessor : public juce::AudioProcessor
+class PluginProcessor : public juce::AudioProcessor,
+                        private juce::Timer
 #if JucePlugin_Enable_ARA
     ,
                         public juce::AudioProcessorARAExtension
@@ -31,6 +34,8 @@ public:
 #endif
 
   void processBlock(juce::AudioBuffer<float> &, juce::MidiBuffer &) override;
+  void processBlock(juce::AudioBuffer<double> &, juce::MidiBuffer &) override;
+  bool supportsDoublePrecisionProcessing() const override { return true; }
 
   // EDITOR
   //==============================================================================
@@ -64,33 +69,88 @@ public:
   static juce::String getDspNameFromOption(DspOption dspOption);
   static DspOption getDspOptionFromName(const juce::String &name);
 
-  DSPOrderFifo<DspOrder> dspOrderFifo;
-  AudioMeterFifo<std::vector<float>> inputLevelFifo;
-  AudioMeterFifo<std::vector<float>> outputLevelFifo;
-  SpectrumAnalyzerFifo<std::vector<float>> analyzerFifo;
+  AudioMeterFifo<MeterLevels> inputLevelFifo;
+  AudioMeterFifo<MeterLevels> outputLevelFifo;
+  SpectrumAnalyzerFifo<float> analyzerFifo;
 
-  juce::dsp::Gain<float> inputGain;
-  juce::dsp::Gain<float> outputGain;
+  juce::SmoothedValue<float> inputGain;
+  juce::SmoothedValue<float> outputGain;
 
   void saveDspOrderToState(const DspOrder &order);
   DspOrder getDspOrderFromState() const;
 
+  // Hands a new order to the audio thread, which picks it up at the start of
+  // its next block. Safe from any thread that isn't the audio thread.
+  void publishDspOrder(const DspOrder &order);
+
   void saveSelectedTabToState(const DspOption &selectedTab);
   DspOption getSelectedTabFromState() const;
 
+  // MULTI-CORE
+  //==============================================================================
+  // Spreads the channel groups of wide buses over the worker pool. Stored in
+  // the state and applied straight away, message thread only.
+  void setMultiCoreEnabled(bool shouldBeEnabled);
+  bool isMultiCoreEnabled() const;
+
   // MANAGERS
   //==============================================================================
+  DspProfiler profiler;
   Parameters parameters;
-  DSP dsp;
+  WorkerPool workers;
+  DSP<float> floatDsp;
+  DSP<double> doubleDsp;
 
 private:
-  // DSP ORDER STATE
+  // Both precisions share the same processing path, only the chain that is
+  // prepared and run differs
+  template <typename SampleType>
+  void processBlockInternal(juce::AudioBuffer<SampleType> &buffer);
+  template <typename SampleType> DSP<SampleType> &getDsp();
+  int getDspLatencySamples();
+  int getNumUsableWorkers() const;
+  void updateWorkers();
+
+  // LATENCY
+  //==============================================================================
+  // setLatencySamples() locks and calls into the host, so the audio thread
+  // only records a new latency in dspLatency. A message thread timer picks it
+  // up and tells the host, posting nothing from the audio thread. The same
+  // timer reclaims retired DSP orders.
+  static constexpr int latencyPollHz = 20;
+  void timerCallback() override;
+  std::atomic<int> dspLatency{0};
+
+  // DSP ORDER HANDOVER
+  //==============================================================================
+  // RCU style: the publisher allocates each new order and publishes it with
+  // an atomic pointer swap. The audio thread swaps it out again, copies it
+  // into both chains and passes the object back through retiredDspOrders, so
+  // it is deleted on the message thread by the timer. Hosts may restore state
+  // on other threads, so publishing never reclaims: the message thread is
+  // the ring's only consumer. Nothing on the audio thread allocates, frees or
+  // locks.
+  void applyPendingDspOrder();
+  void reclaimRetiredDspOrders();
+
+  std::atomic<DspOrder *> pendingDspOrder{nullptr};
+  DSPOrderFifo<DspOrder *> retiredDspOrders;
+
+  // GAIN STAGES
   //==============================================================================
-  DspOrder dspOrder;
+  // Ramps the gain over the block, measures the result and, given a mono
+  // buffer, writes the channel average into it, all in one pass per channel
+  template <typename SampleType>
+  MeterLevels processGainStage(juce::AudioBuffer<SampleType> &buffer,
+                               juce::SmoothedValue<float> &gain,
+                               float gainDecibels, SampleType *mono = nullptr);
 
   // FFT DATA BUFFER
   //==============================================================================
+  // The analyzer always takes floats, a double mix is converted into
+  // samplesForAnalyzer before it is pushed
   std::vector<float> samplesForAnalyzer;
+  std::vector<double> doubleSamplesForAnalyzer;
 
   //==============================================================================
   JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PluginProcessor)
@@ -1,31 +1,17 @@
 #pragma once
 
+#include "SpscRing.h"
 #include <JuceHeader.h>
 
-template <typename T> class AudioMeterFifo{
-public:
-  // Push a new value. Returns false only if FIFO is full (8 pending updates).
-  bool push(const T &value) {
-    auto write = fifo.write(1);
-    if (write.blockSize1 > 0) {
-      slots[static_cast<size_t>(write.startIndex1)] = value;
-      return true;
-    }
-    return false;
-  }
-
-  // Pull the next value. Returns true if a value was available.
-  bool pull(T &value) {
-    auto read = fifo.read(1);
-    if (read.blockSize1 > 0) {
-      value = slots[static_cast<size_t>(read.startIndex1)];
-      return true;
-    }
-    return false;
-  }
-
-private:
-  static constexpr size_t fifoSize = 8;
-  std::array<T, fifoSize> slots;
-  juce::AbstractFifo fifo{fifoSize};
+// Left/right RMS and peak levels, fixed size so a push never allocates. Buses
+// wider than stereo are folded onto the pair by the processor.
+struct MeterLevels {
+  std::array<float, 2> rms{};
+  std::array<float, 2> peak{};
 };
+
+// The audio thread pushes once per block, which at small buffer sizes is far
+// more often than the meters repaint. A meter only shows the newest levels,
+// so the newest win and the oldest are dropped once the ring is full.
+template <typename T>
+using AudioMeterFifo = SpscRing<T, 32, RingOverflow::Overwrite>;
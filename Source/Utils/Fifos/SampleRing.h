@@ -0,0 +1,155 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// SAMPLE RING
+//==============================================================================
+// A continuous stream of samples from one writer to one reader, kept in a
+// power-of-two ring. Positions count every sample ever written, so the reader
+// asks for samples by position and gets exactly the audio that was written
+// there, whatever block sizes the writer used.
+//
+// The writer never waits: it overwrites the oldest samples, and the reader
+// only loses audio if it falls more than Capacity samples behind. Before it
+// touches the ring the writer announces the end of the region it is about to
+// write, so a read that raced with the writer is detected after the copy and
+// reported as failed rather than returning torn audio.
+//
+// A reader with nothing to do can sleep until a given position is written.
+// The writer checks for it after each write and wakes it once with an atomic
+// notify, which unlike an event never locks on its side. The notify is still
+// a futex system call, so the writer only makes it once the reader has
+// actually gone to sleep, at most once per wait.
+template <typename T, size_t Capacity> class SampleRing {
+  static_assert(std::is_trivially_copyable_v<T>,
+                "SampleRing copies its samples with std::copy");
+  static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0,
+                "SampleRing capacity must be a power of two");
+
+public:
+  static constexpr size_t capacity = Capacity;
+
+  // WRITER
+  //============================================================================
+  // One copy into the ring, split in two where it wraps. Only the last
+  // Capacity samples of a longer run are kept.
+  void write(const T *samples, size_t numSamples) {
+    auto position = writePosition.load(std::memory_order_relaxed);
+    if (numSamples > Capacity) {
+      samples += numSamples - Capacity;
+      position += numSamples - Capacity;
+      numSamples = Capacity;
+    }
+
+    const auto end = position + numSamples;
+    writeEnd.store(end, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    const auto start = getIndex(position);
+    const auto firstRun = getFirstRun(start, numSamples);
+    std::copy(samples, samples + firstRun, samplesInRing.begin() + start);
+    std::copy(samples + firstRun, samples + numSamples, samplesInRing.begin());
+    writePosition.store(end, std::memory_order_release);
+
+    // Either this sees the reader's wake position or the reader sees the new
+    // write position, the fences pair with the one in waitForPosition()
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (end >= wakePosition.load(std::memory_order_relaxed)) {
+      wakePosition.store(noWaiter, std::memory_order_relaxed);
+      wakeReader();
+    }
+  }
+
+  // READER
+  //============================================================================
+  // One past the newest sample that can be read
+  juce::uint64 getWritePosition() const {
+    return writePosition.load(std::memory_order_acquire);
+  }
+
+  // The oldest position still held, reading from there on is safe until the
+  // writer moves on
+  juce::uint64 getOldestPosition() const {
+    const auto end = getWritePosition();
+    return end > Capacity ? end - Capacity : 0;
+  }
+
+  // Copies numSamples starting at position into dest. Fails if any of them
+  // have not been written yet or were overwritten before the copy finished.
+  bool read(juce::uint64 position, T *dest, size_t numSamples) const {
+    if (numSamples > Capacity || position < getOldestPosition() ||
+        position + numSamples > getWritePosition()) {
+      return false;
+    }
+
+    const auto start = getIndex(position);
+    const auto firstRun = getFirstRun(start, numSamples);
+    const auto first = samplesInRing.begin() + start;
+    std::copy(first, first + firstRun, dest);
+    std::copy(samplesInRing.begin(),
+              samplesInRing.begin() + (numSamples - firstRun), dest + firstRun);
+
+    // The writer may have lapped the start of the region meanwhile
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return writeEnd.load(std::memory_order_relaxed) <= position + Capacity;
+  }
+
+  // Sleeps until position has been written or wakeReader() is called. A
+  // wakeReader() since the last wait ended returns at once, so one sent just
+  // before the reader starts waiting isn't missed.
+  void waitForPosition(juce::uint64 position) {
+    wakePosition.store(position, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    for (;;) {
+      const auto count = wakeCount.load(std::memory_order_acquire);
+      if (count != readerWakeCount || getWritePosition() >= position) {
+        readerWakeCount = count;
+        break;
+      }
+
+      // Marked before waiting, so wakeReader() either sees the reader parked
+      // and notifies it or has already moved wakeCount on and the wait returns
+      readerParked.store(true);
+      wakeCount.wait(count);
+      readerParked.store(false, std::memory_order_relaxed);
+    }
+    wakePosition.store(noWaiter, std::memory_order_relaxed);
+  }
+
+  // ANY THREAD
+  //============================================================================
+  // Ends the reader's current or next wait, for instance to let it exit
+  void wakeReader() {
+    wakeCount.fetch_add(1);
+    if (readerParked.load()) {
+      wakeCount.notify_one();
+    }
+  }
+
+private:
+  static constexpr size_t mask = Capacity - 1;
+  static constexpr auto noWaiter = std::numeric_limits<juce::uint64>::max();
+
+  static std::ptrdiff_t getIndex(juce::uint64 position) {
+    return static_cast<std::ptrdiff_t>(position & mask);
+  }
+
+  // Samples up to where a copy starting at index wraps, the rest of it goes
+  // to the start of the ring
+  static std::ptrdiff_t getFirstRun(std::ptrdiff_t index, size_t numSamples) {
+    return juce::jmin(static_cast<std::ptrdiff_t>(numSamples),
+                      static_cast<std::ptrdiff_t>(Capacity) - index);
+  }
+
+  alignas(64) std::atomic<juce::uint64> writePosition{0};
+  std::atomic<juce::uint64> writeEnd{0};
+
+  // The position the reader sleeps until, and a count bumped on every wake
+  alignas(64) std::atomic<juce::uint64> wakePosition{noWaiter};
+  std::atomic<juce::uint32> wakeCount{0};
+  std::atomic<bool> readerParked{false}; // In, or about to be in, a wait
+  juce::uint32 readerWakeCount = 0; // Only touched by the reader
+
+  alignas(64) std::array<T, Capacity> samplesInRing{};
+};
@@ -1,31 +1,9 @@
 #pragma once
 
+#include "SampleRing.h"
 #include <JuceHeader.h>
 
-template <typename T> class SpectrumAnalyzerFifo{
-public:
-  // Push a new value. Returns false only if FIFO is full (8 pending updates).
-  bool push(const T &value) {
-    auto write = fifo.write(1);
-    if (write.blockSize1 > 0) {
-      slots[static_cast<size_t>(write.startIndex1)] = value;
-      return true;
-    }
-    return false;
-  }
-
-  // Pull the next value. Returns true if a value was available.
-  bool pull(T &value) {
-    auto read = fifo.read(1);
-    if (read.blockSize1 > 0) {
-      value = slots[static_cast<size_t>(read.startIndex1)];
-      return true;
-    }
-    return false;
-  }
-
-private:
-  static constexpr size_t fifoSize = 8;
-  std::array<T, fifoSize> slots;
-  juce::AbstractFifo fifo{fifoSize};
-};
+// The processor's mono mix on its way to the analyzer. 2^15 samples hold
+// well over half a second at 48 kHz, many times the analyzer's frame and
+// repaint interval, so the analyzer sees the audio without gaps.
+template <typename T> using SpectrumAnalyzerFifo = SampleRing<T, 1 << 15>;
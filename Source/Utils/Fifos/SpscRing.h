@@ -0,0 +1,135 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// What a push does when the consumer has fallen a whole ring behind
+enum class RingOverflow {
+  Reject,   // The new value is dropped, for queues that must keep every value
+  Overwrite // The oldest value is dropped, for meters where the latest wins
+};
+
+// SPSC RING
+//==============================================================================
+// Lock-free single-producer/single-consumer ring of Capacity values, used to
+// pass values between the audio thread and the GUI without locking or
+// allocating on either side.
+//
+// The read and write indices are free-running counters, each on its own cache
+// line next to the owning side's cached copy of the other index, so the two
+// threads only share a line when one has to look at the other's progress.
+//
+// Values are copied in and out, so T has to be trivially copyable. In
+// Overwrite mode the producer never waits, and may be rewriting the very slot
+// the consumer is copying: the consumer checks the write index again after
+// the copy and throws a torn value away.
+//
+// Every value the ring loses, rejected or overwritten, is counted in
+// getNumOverflows().
+template <typename T, size_t Capacity,
+          RingOverflow Overflow = RingOverflow::Reject>
+class SpscRing {
+  static_assert(std::is_trivially_copyable_v<T>,
+                "SpscRing copies its values with plain assignment");
+  static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0,
+                "SpscRing capacity must be a power of two");
+
+public:
+  static constexpr size_t capacity = Capacity;
+
+  // PRODUCER
+  //============================================================================
+  // Returns false if the value was rejected, in Overwrite mode it always goes
+  // in and the oldest unread value is dropped instead
+  bool push(const T &value) {
+    const auto write = producer.index.load(std::memory_order_relaxed);
+    if (write - producer.otherIndex >= Capacity) {
+      producer.otherIndex = consumer.index.load(std::memory_order_acquire);
+      if (write - producer.otherIndex >= Capacity) {
+        overflows.fetch_add(1, std::memory_order_relaxed);
+        if constexpr (Overflow == RingOverflow::Reject) {
+          return false;
+        }
+      }
+    }
+
+    slots[write & mask] = value;
+    producer.index.store(write + 1, std::memory_order_release);
+    return true;
+  }
+
+  // True if a push would be rejected or would overwrite
+  bool isFull() const {
+    return producer.index.load(std::memory_order_relaxed) -
+               consumer.index.load(std::memory_order_acquire) >=
+           Capacity;
+  }
+
+  // CONSUMER
+  //============================================================================
+  // Pops the oldest value still in the ring. Returns false if it is empty.
+  bool pull(T &value) {
+    auto read = consumer.index.load(std::memory_order_relaxed);
+    for (;;) {
+      if (read == consumer.otherIndex) {
+        consumer.otherIndex = producer.index.load(std::memory_order_acquire);
+        if (read == consumer.otherIndex) {
+          consumer.index.store(read, std::memory_order_release);
+          return false;
+        }
+      }
+
+      if constexpr (Overflow == RingOverflow::Overwrite) {
+        // Skip whatever the producer has already lapped
+        if (consumer.otherIndex - read > Capacity) {
+          read = consumer.otherIndex - Capacity;
+        }
+      }
+
+      value = slots[read & mask];
+
+      if constexpr (Overflow == RingOverflow::Overwrite) {
+        // If the producer reached this slot again during the copy the value
+        // may be torn, move on to the next one
+        std::atomic_thread_fence(std::memory_order_acquire);
+        consumer.otherIndex = producer.index.load(std::memory_order_relaxed);
+        if (consumer.otherIndex - read >= Capacity) {
+          ++read;
+          continue;
+        }
+      }
+
+      consumer.index.store(read + 1, std::memory_order_release);
+      return true;
+    }
+  }
+
+  // Drains the ring into value, keeping only the newest. Returns false if it
+  // was empty.
+  bool pullLatest(T &value) {
+    auto pulled = false;
+    while (pull(value)) {
+      pulled = true;
+    }
+    return pulled;
+  }
+
+  // ANY THREAD
+  //============================================================================
+  juce::uint32 getNumOverflows() const {
+    return overflows.load(std::memory_order_relaxed);
+  }
+
+private:
+  static constexpr size_t mask = Capacity - 1;
+
+  // An index written by one side, and that side's last look at the other's
+  struct alignas(64) Side {
+    std::atomic<size_t> index{0};
+    size_t otherIndex = 0;
+  };
+
+  Side producer;
+  Side consumer;
+  alignas(64) std::atomic<juce::uint32> overflows{0};
+  std::array<T, Capacity> slots{};
+};
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// TRIPLE BUFFER
+//==============================================================================
+// Hands the latest of a stream of large values from one writer to one reader
+// without copying, locking or either side ever waiting. The writer fills its
+// own buffer and swaps it with the spare one, the reader swaps the spare one
+// for its own when it is fresh. A value the reader never got to is simply
+// replaced by the next one.
+//
+// All three buffers are copies of the initial value, so sizing it up front
+// (a vector's length, say) keeps both sides free of allocation.
+template <typename T> class TripleBuffer {
+public:
+  explicit TripleBuffer(const T &initialValue = {})
+      : buffers{initialValue, initialValue, initialValue} {}
+
+  // WRITER
+  //============================================================================
+  T &getWriteBuffer() { return buffers[writeIndex]; }
+
+  // Hands the write buffer over as the newest value
+  void publish() {
+    writeIndex = spare.exchange(writeIndex | freshFlag,
+                                std::memory_order_acq_rel) &
+                 indexMask;
+  }
+
+  // READER
+  //============================================================================
+  // Takes the newest value if one was published since the last call. Returns
+  // false and keeps the current read buffer otherwise.
+  bool update() {
+    if ((spare.load(std::memory_order_relaxed) & freshFlag) == 0) {
+      return false;
+    }
+    readIndex = spare.exchange(readIndex, std::memory_order_acq_rel) &
+                indexMask;
+    return true;
+  }
+
+  const T &getReadBuffer() const { return buffers[readIndex]; }
+
+private:
+  static constexpr juce::uint32 indexMask = 3, freshFlag = 4;
+
+  std::array<T, 3> buffers;
+  juce::uint32 writeIndex = 0;
+  alignas(64) std::atomic<juce::uint32> spare{1};
+  alignas(64) juce::uint32 readIndex = 2;
+};
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// FUSED KERNELS
+//==============================================================================
+// Single-pass block kernels for the work processBlock does around the effect
+// chain. Each channel is read and written once: the gain ramp is applied and
+// the peak and sum of squares of the result are gathered in the same loop,
+// optionally adding the channel into a mono mix as well.
+//
+// The chain's parallel sections are merged the same way, every branch
+// multiplied and accumulated into the output in one pass.
+//
+// The body runs on juce::dsp::SIMDRegister with a scalar head up to the first
+// aligned sample and a scalar tail. If the mono buffer is not aligned the same
+// way as the channel the whole channel takes the scalar loop instead, still in
+// a single pass.
+//
+// Instantiated for float and double alike; SIMDRegister<SampleType> holds as
+// many lanes as the type allows, so a double channel runs half as wide.
+namespace FusedKernels {
+
+template <typename SampleType> struct ChannelLevels {
+  SampleType peak = 0;
+  SampleType sumOfSquares = 0;
+};
+
+template <typename SampleType>
+ChannelLevels<SampleType>
+applyGainAndMeasure(SampleType *data, size_t numSamples, SampleType startGain,
+                    SampleType gainStep, SampleType *mono = nullptr,
+                    SampleType monoWeight = 0, bool accumulateMono = false) {
+  ChannelLevels<SampleType> levels;
+  size_t i = 0;
+
+  auto processSample = [&](size_t index) {
+    const auto x = data[index] * (startGain + gainStep * (SampleType)index);
+    data[index] = x;
+    levels.peak = juce::jmax(levels.peak, std::abs(x));
+    levels.sumOfSquares += x * x;
+    if (mono != nullptr) {
+      mono[index] = (accumulateMono ? mono[index] : 0) + x * monoWeight;
+    }
+  };
+
+#if JUCE_USE_SIMD
+  using Simd = juce::dsp::SIMDRegister<SampleType>;
+  constexpr auto width = Simd::size();
+
+  // Samples until data is aligned, or all of them if the mono mix can't
+  // follow data's alignment
+  auto misalignment = [](SampleType *pointer) {
+    return static_cast<size_t>(Simd::getNextSIMDAlignedPtr(pointer) - pointer);
+  };
+  const auto head = mono == nullptr || misalignment(mono) == misalignment(data)
+                        ? juce::jmin(numSamples, misalignment(data))
+                        : numSamples;
+
+  for (; i < head; ++i) {
+    processSample(i);
+  }
+
+  if (i + width <= numSamples) {
+    alignas(Simd::SIMDRegisterSize) SampleType lanes[width];
+    for (size_t lane = 0; lane < width; ++lane) {
+      lanes[lane] = startGain + gainStep * (SampleType)(i + lane);
+    }
+
+    auto gain = Simd::fromRawArray(lanes);
+    const auto gainIncrement = Simd::expand(gainStep * (SampleType)width);
+    const auto weight = Simd::expand(monoWeight);
+    auto peak = Simd::expand(0);
+    auto sumOfSquares = Simd::expand(0);
+
+    for (; i + width <= numSamples; i += width) {
+      const auto x = Simd::fromRawArray(data + i) * gain;
+      x.copyToRawArray(data + i);
+      peak = Simd::max(peak, Simd::abs(x));
+      sumOfSquares += x * x;
+      gain += gainIncrement;
+
+      if (mono != nullptr) {
+        auto mix = x * weight;
+        if (accumulateMono) {
+          mix += Simd::fromRawArray(mono + i);
+        }
+        mix.copyToRawArray(mono + i);
+      }
+    }
+
+    peak.copyToRawArray(lanes);
+    for (size_t lane = 0; lane < width; ++lane) {
+      levels.peak = juce::jmax(levels.peak, lanes[lane]);
+    }
+    levels.sumOfSquares += sumOfSquares.sum();
+  }
+#endif
+
+  for (; i < numSamples; ++i) {
+    processSample(i);
+  }
+
+  return levels;
+}
+
+// dest = sum of sources[k] * gains[k]. dest may be one of the sources.
+template <typename SampleType>
+void mixBranches(SampleType *dest, const SampleType *const *sources,
+                 const SampleType *gains, size_t numSources,
+                 size_t numSamples) {
+  size_t i = 0;
+
+  auto processSample = [&](size_t index) {
+    SampleType sum = 0;
+    for (size_t source = 0; source < numSources; ++source) {
+      sum += sources[source][index] * gains[source];
+    }
+    dest[index] = sum;
+  };
+
+#if JUCE_USE_SIMD
+  using Simd = juce::dsp::SIMDRegister<SampleType>;
+  constexpr auto width = Simd::size();
+
+  // Samples until dest is aligned, or all of them if a source can't follow
+  // dest's alignment
+  auto misalignment = [](const SampleType *pointer) {
+    return static_cast<size_t>(
+        Simd::getNextSIMDAlignedPtr(const_cast<SampleType *>(pointer)) -
+        pointer);
+  };
+  auto head = juce::jmin(numSamples, misalignment(dest));
+  for (size_t source = 0; source < numSources; ++source) {
+    if (misalignment(sources[source]) != misalignment(dest)) {
+      head = numSamples;
+    }
+  }
+
+  for (; i < head; ++i) {
+    processSample(i);
+  }
+
+  for (; i + width <= numSamples; i += width) {
+    auto sum = Simd::expand(0);
+    for (size_t source = 0; source < numSources; ++source) {
+      sum += Simd::fromRawArray(sources[source] + i) * gains[source];
+    }
+    sum.copyToRawArray(dest + i);
+  }
+#endif
+
+  for (; i < numSamples; ++i) {
+    processSample(i);
+  }
+}
+
+} // namespace FusedKernels
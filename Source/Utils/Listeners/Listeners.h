@@ -26,4 +26,5 @@ struct TabButtonEventListener {
   virtual void tabDragStarted(ExtendedTabBarButton *button) = 0;
   virtual void tabDragMoved(ExtendedTabBarButton *button) = 0;
   virtual void tabDragEnded(ExtendedTabBarButton *button) = 0;
+  virtual void tabMenuRequested(ExtendedTabBarButton *button) = 0;
 };
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "../../Processor/DSP/DSP.h"
+#include <JuceHeader.h>
+
+// DSP PROFILER
+//==============================================================================
+// Lock-free CPU accounting. The audio thread adds the ticks it spends in each
+// chain slot and overhead stage, the GUI periodically takes a snapshot which
+// also resets the counters, so every snapshot is an average over the period
+// since the previous one.
+class DspProfiler {
+public:
+  // OrderTransition covers copying the input for the incoming chain and the
+  // crossfade while a new DspOrder fades in. The incoming chain's slots and
+  // its parameter updates count under their own slot and Parameters.
+  enum class Stage {
+    GainAndMeters,
+    Analyzer,
+    Parameters,
+    OrderTransition,
+    END_OF_LIST
+  };
+
+  static constexpr size_t numSlots =
+      static_cast<size_t>(DspOption::END_OF_LIST);
+  static constexpr size_t numStages = static_cast<size_t>(Stage::END_OF_LIST);
+
+  using Ticks = juce::int64;
+  static Ticks now() { return juce::Time::getHighResolutionTicks(); }
+
+  // Timing costs a clock read per stage, so it only runs while a GUI is
+  // showing the numbers
+  void setEnabled(bool shouldBeEnabled) { enabled.store(shouldBeEnabled); }
+  bool isEnabled() const { return enabled.load(std::memory_order_relaxed); }
+
+  // AUDIO THREAD
+  //============================================================================
+  void addSlotTicks(DspOption option, Ticks ticks) {
+    slotTicks[static_cast<size_t>(option)].fetch_add(
+        ticks, std::memory_order_relaxed);
+  }
+
+  void addStageTicks(Stage stage, Ticks ticks) {
+    stageTicks[static_cast<size_t>(stage)].fetch_add(
+        ticks, std::memory_order_relaxed);
+  }
+
+  // Called once per processBlock with the total time spent in it
+  void addBlock(Ticks processingTicks, int numSamples, double sampleRate) {
+    totalTicks.fetch_add(processingTicks, std::memory_order_relaxed);
+    if (sampleRate > 0.0) {
+      audioNanoseconds.fetch_add(
+          static_cast<juce::int64>(numSamples * 1.0e9 / sampleRate),
+          std::memory_order_relaxed);
+    }
+  }
+
+  struct ScopedStageTimer {
+    ScopedStageTimer(DspProfiler &p, Stage s)
+        : profiler(p), stage(s), enabled(p.isEnabled()),
+          start(enabled ? now() : 0) {}
+    ~ScopedStageTimer() {
+      if (enabled) {
+        profiler.addStageTicks(stage, now() - start);
+      }
+    }
+
+    DspProfiler &profiler;
+    Stage stage;
+    bool enabled;
+    Ticks start;
+  };
+
+  // GUI THREAD
+  //============================================================================
+  // Loads are fractions of the audio duration processed since the last call
+  struct Snapshot {
+    std::array<double, numSlots> slotLoad{};
+    std::array<double, numStages> stageLoad{};
+    double totalLoad = 0.0;
+    bool isValid = false;
+  };
+
+  Snapshot takeSnapshot() {
+    Snapshot snapshot;
+    auto audioSeconds = audioNanoseconds.exchange(0) * 1.0e-9;
+    if (audioSeconds <= 0.0) {
+      return snapshot;
+    }
+
+    auto toLoad = [audioSeconds](Ticks ticks) {
+      return juce::Time::highResolutionTicksToSeconds(ticks) / audioSeconds;
+    };
+
+    for (size_t i = 0; i < numSlots; ++i) {
+      snapshot.slotLoad[i] = toLoad(slotTicks[i].exchange(0));
+    }
+    for (size_t i = 0; i < numStages; ++i) {
+      snapshot.stageLoad[i] = toLoad(stageTicks[i].exchange(0));
+    }
+    snapshot.totalLoad = toLoad(totalTicks.exchange(0));
+    snapshot.isValid = true;
+    return snapshot;
+  }
+
+private:
+  std::array<std::atomic<Ticks>, numSlots> slotTicks{};
+  std::array<std::atomic<Ticks>, numStages> stageTicks{};
+  std::atomic<Ticks> totalTicks{0};
+  std::atomic<juce::int64> audioNanoseconds{0};
+  std::atomic<bool> enabled{false};
+};
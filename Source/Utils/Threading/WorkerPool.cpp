@@ -0,0 +1,198 @@
+#include "WorkerPool.h"
+#if JUCE_INTEL
+#include <immintrin.h>
+#endif
+
+namespace {
+// Spins on the audio thread before it looks for claimed jobs to take over.
+// Long enough for a worker between claiming a job and starting it, far
+// shorter than any job.
+constexpr int maxSpins = 1024;
+
+// Tells the core we are spinning, which saves power and frees the pipeline
+// for a hyperthread sibling that may be the worker we're waiting on
+inline void pauseCpu() {
+#if JUCE_INTEL
+  _mm_pause();
+#elif JUCE_ARM && (JUCE_GCC || JUCE_CLANG)
+  __asm__ __volatile__("yield");
+#endif
+}
+} // namespace
+
+// WORKERS
+//==============================================================================
+WorkerPool::Worker::Worker(WorkerPool &p, int i)
+    : juce::Thread("Channel Group Worker"), pool(p), index(i) {}
+
+void WorkerPool::Worker::run() {
+  juce::ScopedNoDenormals noDenormals;
+
+  for (;;) {
+    // Read before checking for exit and looking for work, so a stop() or a
+    // batch published in between still falls through the wait below
+    const auto active = pool.activeCount.load(std::memory_order_acquire);
+    const auto wake = pool.wakeCount.load(std::memory_order_acquire);
+    if (threadShouldExit()) {
+      return;
+    }
+
+    // Parked workers take no jobs and aren't woken for any, only by a change
+    // of the active count or stop()
+    if (index >= pool.numActive.load(std::memory_order_acquire)) {
+      pool.activeCount.wait(active);
+      continue;
+    }
+
+    pool.runJobs();
+
+    // Counted before waiting, so run() either sees this worker parked and
+    // notifies it or has already moved wakeCount on and the wait returns
+    pool.numParked.fetch_add(1);
+    pool.wakeCount.wait(wake);
+    pool.numParked.fetch_sub(1, std::memory_order_relaxed);
+  }
+}
+
+// AUDIO THREAD STOPPED
+//==============================================================================
+void WorkerPool::start(int numWorkers, int blockSize, double sampleRate) {
+  stop();
+
+  const auto options =
+      juce::Thread::RealtimeOptions{}.withApproximateAudioProcessingTime(
+          blockSize, sampleRate);
+
+  for (int i = 0; i < juce::jlimit(0, maxWorkers, numWorkers); ++i) {
+    auto worker = std::make_unique<Worker>(*this, i);
+    if (!worker->startRealtimeThread(options)) {
+      break;
+    }
+    workers.push_back(std::move(worker));
+  }
+
+  numRunning.store(static_cast<int>(workers.size()));
+}
+
+void WorkerPool::stop() {
+  numRunning.store(0);
+
+  for (auto &worker : workers) {
+    worker->signalThreadShouldExit();
+  }
+  wakeCount.fetch_add(1, std::memory_order_release);
+  wakeCount.notify_all();
+  activeCount.fetch_add(1, std::memory_order_release);
+  activeCount.notify_all();
+
+  // Each worker sees the exit flag once its current job is done, so this
+  // never has to give up on one and kill it
+  for (auto &worker : workers) {
+    worker->stopThread(-1);
+  }
+  workers.clear();
+}
+
+// ANY THREAD
+//==============================================================================
+void WorkerPool::setNumActiveWorkers(int numWorkers) {
+  numActive.store(juce::jlimit(0, maxWorkers, numWorkers));
+
+  // A worker parked from now on reads the new count, and one that already is
+  // sees activeCount move on. Workers turned off park once they wake for the
+  // next batch.
+  activeCount.fetch_add(1, std::memory_order_release);
+  activeCount.notify_all();
+}
+
+// AUDIO THREAD
+//==============================================================================
+void WorkerPool::run(size_t numJobs, Job newJob, void *newContext) {
+  if (numJobs == 0) {
+    return;
+  }
+
+  if (numRunning.load(std::memory_order_relaxed) == 0 ||
+      numActive.load(std::memory_order_relaxed) == 0 || numJobs == 1 ||
+      numJobs > maxJobs) {
+    for (size_t i = 0; i < numJobs; ++i) {
+      newJob(newContext, i);
+    }
+    return;
+  }
+
+  const auto batch = ++batchCount;
+  job.store(newJob, std::memory_order_relaxed);
+  context.store(newContext, std::memory_order_relaxed);
+  pending.store(numJobs, std::memory_order_relaxed);
+  claim.store(makeClaim(batch, static_cast<juce::uint32>(numJobs), 0),
+              std::memory_order_release);
+
+  // A futex wake is a system call, only worth making when a worker sleeps
+  wakeCount.fetch_add(1);
+  if (numParked.load() > 0) {
+    wakeCount.notify_all();
+  }
+
+  runJobs();
+
+  // Only jobs a worker has already claimed are left
+  for (int spin = 0; spin < maxSpins; ++spin) {
+    if (pending.load(std::memory_order_acquire) == 0) {
+      return;
+    }
+    pauseCpu();
+  }
+
+  // Whatever hasn't started by now, its worker was held up after claiming it
+  for (size_t i = 0; i < numJobs; ++i) {
+    if (startJob(i, batch)) {
+      newJob(newContext, i);
+      pending.fetch_sub(1, std::memory_order_release);
+    }
+  }
+
+  // The rest are running on workers and can't be taken over
+  while (pending.load(std::memory_order_acquire) > 0) {
+    std::this_thread::yield();
+  }
+}
+
+void WorkerPool::runJobs() {
+  auto current = claim.load(std::memory_order_acquire);
+
+  for (;;) {
+    const auto numJobs = (current >> 16) & 0xffff;
+    const auto nextJob = current & 0xffff;
+    if (nextJob >= numJobs) {
+      return;
+    }
+
+    if (claim.compare_exchange_weak(current, current + 1,
+                                    std::memory_order_acq_rel,
+                                    std::memory_order_acquire)) {
+      const auto index = static_cast<size_t>(nextJob);
+      if (startJob(index, static_cast<juce::uint32>(current >> 32))) {
+        job.load(std::memory_order_relaxed)(
+            context.load(std::memory_order_relaxed), index);
+        pending.fetch_sub(1, std::memory_order_release);
+      }
+    }
+  }
+}
+
+bool WorkerPool::startJob(size_t index, juce::uint32 batch) {
+  // A batch only ends once every job in it has finished, so a job not yet
+  // started in this batch still belongs to it and job and context are its
+  // own. A worker held up since an earlier batch finds a later one here.
+  auto started = startedBatch[index].load(std::memory_order_relaxed);
+  while (static_cast<juce::int32>(batch - started) > 0) {
+    if (startedBatch[index].compare_exchange_weak(
+            started, batch, std::memory_order_acquire,
+            std::memory_order_relaxed)) {
+      return true;
+    }
+  }
+  return false;
+}
+
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// WORKER POOL
+//==============================================================================
+// A few real-time priority threads that help the audio thread through a batch
+// of independent jobs. The audio thread publishes a batch with one atomic
+// store, wakes the workers and then claims jobs alongside them, so a batch
+// never waits on a worker that is asleep or was never started: whatever the
+// workers don't pick up the audio thread runs itself. It only waits for jobs
+// a worker is already in the middle of: after a short spin it takes over any
+// job a worker claimed but hasn't started, say because it was preempted, and
+// yields its time slice to the ones still running.
+//
+// Threads are started and stopped while the audio thread is stopped, in
+// prepareToPlay and releaseResources. How many of them take jobs can change
+// from any thread at any time: the others park on a futex until they are
+// needed again, so no thread is ever restarted under a running audio
+// thread. run() is called on the audio thread and neither locks nor
+// allocates.
+class WorkerPool {
+public:
+  using Job = void (*)(void *context, size_t index);
+
+  static constexpr int maxWorkers = 3;
+  static constexpr size_t maxJobs = 16; // Larger batches run inline
+
+  ~WorkerPool() { stop(); }
+
+  // AUDIO THREAD STOPPED
+  //============================================================================
+  // Restarts the pool with up to numWorkers threads, scheduled for blocks of
+  // blockSize samples. Threads that can't get real-time priority aren't
+  // started, leaving their share of the work to the audio thread. stop()
+  // waits for every thread to finish its job and exit, it never kills one.
+  void start(int numWorkers, int blockSize, double sampleRate);
+  void stop();
+
+  // ANY THREAD
+  //============================================================================
+  // Lets the first numWorkers started threads take jobs and parks the rest
+  void setNumActiveWorkers(int numWorkers);
+  int getNumWorkers() const {
+    return juce::jmin(numActive.load(), numRunning.load());
+  }
+
+  // AUDIO THREAD
+  //============================================================================
+  // Calls job(context, i) for every i below numJobs and returns once all of
+  // them have finished
+  void run(size_t numJobs, Job job, void *context);
+
+private:
+  class Worker : public juce::Thread {
+  public:
+    Worker(WorkerPool &pool, int index);
+    void run() override;
+
+  private:
+    WorkerPool &pool;
+    const int index;
+  };
+
+  // Claims and runs jobs of the current batch until none are left
+  void runJobs();
+
+  // Marks a job as started in a batch, returning false if someone else has
+  // started it already or the batch is over. Whoever starts it runs it.
+  bool startJob(size_t index, juce::uint32 batch);
+
+  // The batch and the next unclaimed job share one word, so a worker still
+  // holding a previous batch can never claim from a newer one
+  static constexpr juce::uint64 makeClaim(juce::uint32 batch,
+                                          juce::uint32 numJobs,
+                                          juce::uint32 nextJob) {
+    return (static_cast<juce::uint64>(batch) << 32) |
+           (static_cast<juce::uint64>(numJobs) << 16) | nextJob;
+  }
+
+  std::vector<std::unique_ptr<Worker>> workers;
+  std::atomic<int> numRunning{0};
+  std::atomic<int> numActive{0};
+  std::atomic<juce::uint32> activeCount{0}; // Moves on with every change
+
+  alignas(64) std::atomic<juce::uint64> claim{0};
+  std::atomic<juce::uint32> wakeCount{0};
+  std::atomic<int> numParked{0}; // Workers in, or about to be in, a wait
+  std::atomic<Job> job{nullptr};
+  std::atomic<void *> context{nullptr};
+  juce::uint32 batchCount = 0; // Only touched by the audio thread
+
+  // The last batch each job was started in
+  std::array<std::atomic<juce::uint32>, maxJobs> startedBatch{};
+
+  alignas(64) std::atomic<size_t> pending{0};
+};
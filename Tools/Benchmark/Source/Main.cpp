@@ -0,0 +1,382 @@
+#include "../../../Source/Processor/PluginProcessor/PluginProcessor.h"
+#include <JuceHeader.h>
+#include <iomanip>
+#include <iostream>
+
+// OPTIONS
+//==============================================================================
+struct BenchmarkOptions {
+  juce::Array<double> sampleRates{44100.0, 48000.0, 96000.0, 192000.0};
+  juce::Array<int> blockSizes{16, 32, 64, 128, 256, 512, 1024, 2048, 4096};
+  double secondsPerRun = 0.5;
+  int repeats = 5;
+  int numChannels = 2;
+  bool multiCore = false;
+  bool bypassSweep = false;
+  bool automate = false;
+  bool reorder = false;
+  juce::File jsonFile;
+  juce::File baselineFile;
+};
+
+template <typename T>
+static juce::Array<T> parseList(const juce::String &text) {
+  juce::Array<T> values;
+  for (const auto &token : juce::StringArray::fromTokens(text, ",", "")) {
+    if (token.trim().isNotEmpty()) {
+      values.add(static_cast<T>(token.trim().getDoubleValue()));
+    }
+  }
+  return values;
+}
+
+static BenchmarkOptions parseOptions(const juce::ArgumentList &args) {
+  BenchmarkOptions options;
+
+  if (args.containsOption("--sample-rates")) {
+    options.sampleRates =
+        parseList<double>(args.getValueForOption("--sample-rates"));
+  }
+  if (args.containsOption("--block-sizes")) {
+    options.blockSizes = parseList<int>(args.getValueForOption("--block-sizes"));
+  }
+  if (args.containsOption("--seconds")) {
+    options.secondsPerRun =
+        args.getValueForOption("--seconds").getDoubleValue();
+  }
+  if (args.containsOption("--repeats")) {
+    options.repeats = args.getValueForOption("--repeats").getIntValue();
+  }
+  if (args.containsOption("--channels")) {
+    options.numChannels = args.getValueForOption("--channels").getIntValue();
+  }
+  if (args.containsOption("--json")) {
+    options.jsonFile = args.getFileForOption("--json");
+  }
+  if (args.containsOption("--baseline")) {
+    options.baselineFile = args.getExistingFileForOption("--baseline");
+  }
+  options.bypassSweep = args.containsOption("--bypass-sweep");
+  options.automate = args.containsOption("--automate");
+  options.reorder = args.containsOption("--reorder");
+  options.multiCore = args.containsOption("--multi-core");
+
+  if (options.sampleRates.isEmpty() || options.blockSizes.isEmpty() ||
+      options.secondsPerRun <= 0.0 || options.repeats <= 0 ||
+      options.numChannels < 1 || options.numChannels > maxDspChannels) {
+    juce::ConsoleApplication::fail("Invalid benchmark options");
+  }
+
+  return options;
+}
+
+// CASES
+//==============================================================================
+// A case is a set of active (non-bypassed) slots, the rest are bypassed
+struct BenchmarkCase {
+  juce::String name;
+  std::array<bool, static_cast<size_t>(DspOption::END_OF_LIST)> active{};
+};
+
+static juce::AudioParameterBool *getBypassParameter(Parameters &parameters,
+                                                    DspOption option) {
+  switch (option) {
+  case DspOption::Phase:
+    return parameters.phaserBypass;
+  case DspOption::Chorus:
+    return parameters.chorusBypass;
+  case DspOption::OverDrive:
+    return parameters.overdriveBypass;
+  case DspOption::LadderFilter:
+    return parameters.ladderFilterBypass;
+  case DspOption::Filter:
+    return parameters.filterBypass;
+  case DspOption::END_OF_LIST:
+    break;
+  }
+  jassertfalse;
+  return nullptr;
+}
+
+static std::vector<BenchmarkCase> createCases(bool bypassSweep) {
+  constexpr auto numOptions = static_cast<size_t>(DspOption::END_OF_LIST);
+  std::vector<BenchmarkCase> cases;
+
+  // Each processor on its own
+  for (size_t i = 0; i < numOptions; ++i) {
+    BenchmarkCase benchmarkCase;
+    benchmarkCase.name =
+        PluginProcessor::getDspNameFromOption(static_cast<DspOption>(i));
+    benchmarkCase.active[i] = true;
+    cases.push_back(benchmarkCase);
+  }
+
+  // Full chain and everything bypassed
+  BenchmarkCase fullChain{"Full Chain", {}};
+  fullChain.active.fill(true);
+  cases.push_back(fullChain);
+  cases.push_back({"All Bypassed", {}});
+
+  // Every remaining bypass combination
+  if (bypassSweep) {
+    for (int mask = 1; mask < (1 << numOptions) - 1; ++mask) {
+      if (juce::isPowerOfTwo(mask)) {
+        continue; // Already covered by the single processor cases
+      }
+
+      BenchmarkCase benchmarkCase;
+      juce::StringArray names;
+      for (size_t i = 0; i < numOptions; ++i) {
+        benchmarkCase.active[i] = (mask & (1 << i)) != 0;
+        if (benchmarkCase.active[i]) {
+          names.add(PluginProcessor::getDspNameFromOption(
+              static_cast<DspOption>(i)));
+        }
+      }
+      benchmarkCase.name = names.joinIntoString(" + ");
+      cases.push_back(benchmarkCase);
+    }
+  }
+
+  return cases;
+}
+
+// RUNNER
+//==============================================================================
+struct BenchmarkResult {
+  juce::String name;
+  double sampleRate = 0.0;
+  int blockSize = 0;
+  double nsPerSample = 0.0;
+
+  juce::String getKey() const {
+    return name + " @ " + juce::String(sampleRate, 0) + " Hz / " +
+           juce::String(blockSize);
+  }
+};
+
+// Moves every float parameter to a new random value so the smoothers ramp
+static void automateParameters(juce::AudioProcessor &processor,
+                               juce::Random &random) {
+  for (auto *parameter : processor.getParameters()) {
+    if (dynamic_cast<juce::AudioParameterFloat *>(parameter) != nullptr) {
+      parameter->setValueNotifyingHost(random.nextFloat());
+    }
+  }
+}
+
+// The default order back to front, for --reorder to flip to
+static DspOrder getReversedOrder() {
+  DspOrder order;
+  for (size_t i = numDspOptions; i > 0; --i) {
+    order.add(static_cast<DspOption>(i - 1));
+  }
+  return order;
+}
+
+// Times DSP::processBlock on a block of options.numChannels, including the
+// smoother update that precedes it in PluginProcessor::processBlock
+static double runCase(PluginProcessor &processor, const BenchmarkCase &bench,
+                      double sampleRate, int blockSize,
+                      const BenchmarkOptions &options) {
+  auto &parameters = processor.parameters;
+
+  for (size_t i = 0; i < bench.active.size(); ++i) {
+    *getBypassParameter(parameters, static_cast<DspOption>(i)) =
+        !bench.active[i];
+  }
+
+  const auto numChannels = options.numChannels;
+  processor.setPlayConfigDetails(numChannels, numChannels, sampleRate,
+                                 blockSize);
+  processor.prepareToPlay(sampleRate, blockSize);
+
+  juce::dsp::ProcessSpec spec;
+  spec.sampleRate = sampleRate;
+  spec.maximumBlockSize = static_cast<juce::uint32>(blockSize);
+  spec.numChannels = static_cast<juce::uint32>(numChannels);
+
+  // Shares the processor's worker pool, which prepareToPlay sized for the
+  // same bus
+  DSP<float> dsp(parameters, processor.profiler, processor.workers);
+  dsp.prepareToPlay(spec);
+
+  dsp.setDspOrder(DspOrder::getDefault());
+
+  // Fixed seed noise so every run sees the same signal
+  juce::Random random(1234);
+  juce::AudioBuffer<float> source(numChannels, blockSize);
+  juce::AudioBuffer<float> work(numChannels, blockSize);
+  for (int channel = 0; channel < source.getNumChannels(); ++channel) {
+    for (int i = 0; i < blockSize; ++i) {
+      source.setSample(channel, i, random.nextFloat() * 2.0f - 1.0f);
+    }
+  }
+
+  const auto numBlocks = juce::jmax(
+      1, static_cast<int>(options.secondsPerRun * sampleRate / blockSize));
+  const auto automationInterval =
+      juce::jmax(1, static_cast<int>(0.05 * sampleRate / blockSize));
+
+  // Twice the transition time, so the order is crossfading about half of the
+  // time
+  const auto reorderInterval = juce::jmax(
+      1, static_cast<int>(2.0 * DSP<float>::transitionSeconds * sampleRate /
+                          blockSize));
+  const auto reversedOrder = getReversedOrder();
+  auto reversed = false;
+
+  auto runOnce = [&]() {
+    juce::int64 ticks = 0;
+    for (int block = 0; block < numBlocks; ++block) {
+      if (options.automate && block % automationInterval == 0) {
+        automateParameters(processor, random);
+      }
+      work.makeCopyOf(source, true);
+      auto audioBlock = juce::dsp::AudioBlock<float>(work);
+
+      const auto startTicks = juce::Time::getHighResolutionTicks();
+      if (options.reorder && block % reorderInterval == 0) {
+        reversed = !reversed;
+        dsp.setDspOrder(reversed ? reversedOrder : DspOrder::getDefault());
+      }
+      parameters.updateSmoothers(
+          Parameters::SmootherUpdateMode::updateExisting);
+      dsp.processBlock(audioBlock);
+      ticks += juce::Time::getHighResolutionTicks() - startTicks;
+    }
+    return juce::Time::highResolutionTicksToSeconds(ticks) * 1.0e9 /
+           (static_cast<double>(numBlocks) * blockSize);
+  };
+
+  runOnce(); // Warm up caches and let the smoothers settle
+
+  std::vector<double> timings;
+  for (int i = 0; i < options.repeats; ++i) {
+    timings.push_back(runOnce());
+  }
+
+  // Median is robust to the odd scheduler hiccup
+  std::sort(timings.begin(), timings.end());
+  return timings[timings.size() / 2];
+}
+
+// JSON
+//==============================================================================
+static juce::var toJson(const std::vector<BenchmarkResult> &results,
+                        const BenchmarkOptions &options) {
+  juce::Array<juce::var> resultList;
+  for (const auto &result : results) {
+    auto *entry = new juce::DynamicObject();
+    entry->setProperty("case", result.name);
+    entry->setProperty("sampleRate", result.sampleRate);
+    entry->setProperty("blockSize", result.blockSize);
+    entry->setProperty("nsPerSample", result.nsPerSample);
+    resultList.add(juce::var(entry));
+  }
+
+  auto *root = new juce::DynamicObject();
+  root->setProperty("version", 1);
+  root->setProperty("secondsPerRun", options.secondsPerRun);
+  root->setProperty("repeats", options.repeats);
+  root->setProperty("automate", options.automate);
+  root->setProperty("reorder", options.reorder);
+  root->setProperty("channels", options.numChannels);
+  root->setProperty("multiCore", options.multiCore);
+  root->setProperty("results", resultList);
+  return juce::var(root);
+}
+
+static std::map<juce::String, double> loadBaseline(const juce::File &file) {
+  std::map<juce::String, double> baseline;
+  auto json = juce::JSON::parse(file);
+
+  if (auto *results = json.getProperty("results", {}).getArray()) {
+    for (const auto &entry : *results) {
+      BenchmarkResult result;
+      result.name = entry.getProperty("case", {}).toString();
+      result.sampleRate = entry.getProperty("sampleRate", 0.0);
+      result.blockSize = entry.getProperty("blockSize", 0);
+      baseline[result.getKey()] = entry.getProperty("nsPerSample", 0.0);
+    }
+  } else {
+    juce::ConsoleApplication::fail("Could not parse baseline " +
+                                   file.getFullPathName());
+  }
+
+  return baseline;
+}
+
+// BENCHMARK
+//==============================================================================
+static void runBenchmark(const BenchmarkOptions &options) {
+  std::map<juce::String, double> baseline;
+  if (options.baselineFile.existsAsFile()) {
+    baseline = loadBaseline(options.baselineFile);
+  }
+
+  PluginProcessor processor;
+  processor.setMultiCoreEnabled(options.multiCore);
+  std::vector<BenchmarkResult> results;
+
+  std::cout << std::fixed << std::setprecision(2);
+
+  for (const auto &bench : createCases(options.bypassSweep)) {
+    for (auto sampleRate : options.sampleRates) {
+      for (auto blockSize : options.blockSizes) {
+        BenchmarkResult result{bench.name, sampleRate, blockSize};
+        result.nsPerSample =
+            runCase(processor, bench, sampleRate, blockSize, options);
+        results.push_back(result);
+
+        std::cout << std::left << std::setw(48)
+                  << result.getKey().toStdString() << std::right
+                  << std::setw(10) << result.nsPerSample << " ns/sample";
+
+        auto previous = baseline.find(result.getKey());
+        if (previous != baseline.end() && previous->second > 0.0) {
+          auto change =
+              (result.nsPerSample - previous->second) / previous->second;
+          std::cout << "  (" << std::showpos << change * 100.0
+                    << std::noshowpos << "% vs baseline)";
+        }
+        std::cout << std::endl;
+      }
+    }
+  }
+
+  if (options.jsonFile != juce::File()) {
+    if (!options.jsonFile.replaceWithText(
+            juce::JSON::toString(toJson(results, options)))) {
+      juce::ConsoleApplication::fail("Could not write " +
+                                     options.jsonFile.getFullPathName());
+    }
+    std::cout << "Wrote " << options.jsonFile.getFullPathName() << std::endl;
+  }
+}
+
+// MAIN
+//==============================================================================
+int main(int argc, char *argv[]) {
+  // Parameters rely on the message manager for their value tree timers
+  juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+  juce::ConsoleApplication app;
+  app.addHelpCommand("--help|-h", "Usage:", true);
+  app.addDefaultCommand(
+      {"",
+       "[--sample-rates 44100,48000] [--block-sizes 64,512] [--seconds 0.5] "
+       "[--repeats 5] [--channels 2] [--multi-core] [--bypass-sweep] "
+       "[--automate] [--reorder] [--json <file>] [--baseline <file>]",
+       "Times DSP::processBlock for every DspOption and the full chain",
+       "Reports the median ns/sample (per frame of --channels channels) of "
+       "DSP::processBlock for each case, sample rate and block size. "
+       "--multi-core spreads the channel groups over the worker pool. "
+       "--bypass-sweep adds every bypass combination, --automate keeps the "
+       "smoothers moving, --reorder keeps flipping the effect order so the "
+       "order crossfades are included, --json writes the results and "
+       "--baseline compares against a previously written file.",
+       [](const juce::ArgumentList &args) { runBenchmark(parseOptions(args)); }});
+
+  return app.findAndRunCommand(argc, argv);
+}
@@ -0,0 +1,209 @@
+#include "../../../Source/Processor/PluginProcessor/PluginProcessor.h"
+#include "RealtimeSanitizer.h"
+#include <JuceHeader.h>
+#include <iostream>
+
+// OPTIONS
+//==============================================================================
+struct RenderOptions {
+  juce::File inputFile;
+  juce::File outputFile;
+  juce::File stateFile;
+  int blockSize = 512;
+  bool realtimeCheck = false;
+  bool multiCore = false;
+};
+
+static RenderOptions parseOptions(const juce::ArgumentList &args) {
+  RenderOptions options;
+  options.inputFile = args.getExistingFileForOption("--input");
+  options.outputFile = args.getFileForOption("--output");
+
+  if (args.containsOption("--state")) {
+    options.stateFile = args.getExistingFileForOption("--state");
+  }
+
+  if (args.containsOption("--block-size")) {
+    options.blockSize = args.getValueForOption("--block-size").getIntValue();
+    if (options.blockSize <= 0) {
+      juce::ConsoleApplication::fail("--block-size must be greater than 0");
+    }
+  }
+
+  options.realtimeCheck = args.containsOption("--rt-check");
+  if (options.realtimeCheck && !RealtimeSanitizer::isSupported()) {
+    juce::ConsoleApplication::fail("--rt-check is only supported on Linux");
+  }
+
+  options.multiCore = args.containsOption("--multi-core");
+
+  return options;
+}
+
+// RENDER
+//==============================================================================
+static void render(const RenderOptions &options) {
+  juce::AudioFormatManager formatManager;
+  formatManager.registerBasicFormats();
+
+  std::unique_ptr<juce::AudioFormatReader> reader(
+      formatManager.createReaderFor(options.inputFile));
+  if (reader == nullptr) {
+    juce::ConsoleApplication::fail("Could not read " +
+                                   options.inputFile.getFullPathName());
+  }
+
+  const auto sampleRate = reader->sampleRate;
+  const auto numFileChannels = static_cast<int>(reader->numChannels);
+  const auto totalSamples = reader->lengthInSamples;
+  const auto blockSize = options.blockSize;
+
+  // Files are processed on a bus of their own width, up to a 7.1.4 bed
+  if (numFileChannels > maxDspChannels) {
+    juce::ConsoleApplication::fail(
+        options.inputFile.getFullPathName() + " has " +
+        juce::String(numFileChannels) + " channels, at most " +
+        juce::String(maxDspChannels) + " are supported");
+  }
+  const int numProcessChannels = numFileChannels;
+
+  // Load the preset before preparing so smoothers start at the stored values
+  PluginProcessor processor;
+  if (options.stateFile.existsAsFile()) {
+    juce::MemoryBlock state;
+    if (!options.stateFile.loadFileAsData(state)) {
+      juce::ConsoleApplication::fail("Could not read " +
+                                     options.stateFile.getFullPathName());
+    }
+    processor.setStateInformation(state.getData(),
+                                  static_cast<int>(state.getSize()));
+  }
+
+  processor.setMultiCoreEnabled(options.multiCore);
+  processor.setPlayConfigDetails(numProcessChannels, numProcessChannels,
+                                 sampleRate, blockSize);
+  processor.prepareToPlay(sampleRate, blockSize);
+
+  // Writer
+  const auto sourceBits = static_cast<int>(reader->bitsPerSample);
+  const auto bitsPerSample =
+      (sourceBits == 16 || sourceBits == 24 || sourceBits == 32) ? sourceBits
+                                                                 : 24;
+
+  options.outputFile.deleteFile();
+  auto outputStream = options.outputFile.createOutputStream();
+  if (outputStream == nullptr) {
+    juce::ConsoleApplication::fail("Could not create " +
+                                   options.outputFile.getFullPathName());
+  }
+
+  juce::WavAudioFormat wavFormat;
+  std::unique_ptr<juce::AudioFormatWriter> writer(wavFormat.createWriterFor(
+      outputStream.get(), sampleRate, static_cast<unsigned int>(numFileChannels),
+      bitsPerSample, {}, 0));
+  if (writer == nullptr) {
+    juce::ConsoleApplication::fail("Could not create a WAV writer for " +
+                                   options.outputFile.getFullPathName());
+  }
+  outputStream.release(); // Owned by the writer from here on
+
+  // Stream the file through processBlock in host-sized blocks, then keep
+  // feeding silence until the latency and the effects' tails are flushed. The
+  // first latency samples out are the chain's delay line, so they are dropped
+  // and the output lines up with the input.
+  const auto latency = processor.getLatencySamples();
+  const auto outputLength =
+      totalSamples + static_cast<juce::int64>(std::ceil(
+                         processor.getTailLengthSeconds() * sampleRate));
+  const auto numProcessed = outputLength + latency;
+
+  juce::AudioBuffer<float> buffer(numProcessChannels, blockSize);
+  juce::MidiBuffer midiMessages;
+  juce::int64 processingTicks = 0;
+  RealtimeSanitizer::setEnabled(options.realtimeCheck);
+
+  for (juce::int64 position = 0; position < numProcessed;
+       position += blockSize) {
+    const auto numSamples = static_cast<int>(
+        juce::jmin<juce::int64>(blockSize, numProcessed - position));
+    const auto numFromFile = static_cast<int>(juce::jlimit<juce::int64>(
+        0, numSamples, totalSamples - position));
+    buffer.setSize(numProcessChannels, numSamples, false, false, true);
+    buffer.clear();
+    if (numFromFile > 0) {
+      reader->read(&buffer, 0, numFromFile, position, true, true);
+    }
+
+    const auto startTicks = juce::Time::getHighResolutionTicks();
+    {
+      RealtimeSanitizer::ScopedAudioThread audioThread;
+      processor.processBlock(buffer, midiMessages);
+    }
+    processingTicks += juce::Time::getHighResolutionTicks() - startTicks;
+
+    const auto numLatent = static_cast<int>(
+        juce::jlimit<juce::int64>(0, numSamples, latency - position));
+    if (numLatent < numSamples) {
+      writer->writeFromAudioSampleBuffer(buffer, numLatent,
+                                         numSamples - numLatent);
+    }
+  }
+
+  RealtimeSanitizer::setEnabled(false);
+  processor.releaseResources();
+
+  // Report
+  const auto processingSeconds =
+      juce::Time::highResolutionTicksToSeconds(processingTicks);
+  const auto audioSeconds = static_cast<double>(numProcessed) / sampleRate;
+  const auto nsPerSample =
+      numProcessed > 0 ? processingSeconds * 1.0e9 / (double)numProcessed
+                       : 0.0;
+
+  std::cout << "Rendered " << options.outputFile.getFullPathName() << "\n"
+            << "  " << outputLength << " samples (" << totalSamples
+            << " in, " << outputLength - totalSamples << " tail) @ "
+            << sampleRate << " Hz, block size " << blockSize << ", latency "
+            << latency << "\n"
+            << "  processBlock: " << processingSeconds * 1000.0 << " ms ("
+            << nsPerSample << " ns/sample, "
+            << (processingSeconds > 0.0 ? audioSeconds / processingSeconds
+                                        : 0.0)
+            << "x realtime)" << std::endl;
+
+  if (options.realtimeCheck) {
+    auto violations = RealtimeSanitizer::getViolations();
+    std::cout << "  realtime check: " << violations.allocations
+              << " allocations, " << violations.deallocations << " frees, "
+              << violations.lockAcquisitions << " mutex locks" << std::endl;
+
+    if (violations.getTotal() > 0) {
+      juce::ConsoleApplication::fail(
+          "processBlock is not realtime safe (see counts above)");
+    }
+  }
+}
+
+// MAIN
+//==============================================================================
+int main(int argc, char *argv[]) {
+  // Parameters rely on the message manager for their value tree timers
+  juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+  juce::ConsoleApplication app;
+  app.addHelpCommand("--help|-h", "Usage:", true);
+  app.addDefaultCommand(
+      {"",
+       "--input <file> --output <file.wav> [--state <file>] "
+       "[--block-size <samples>] [--rt-check] [--multi-core]",
+       "Renders an audio file through the plugin's processBlock",
+       "Loads an optional state blob (as written by getStateInformation), "
+       "streams the input through processBlock in blocks of --block-size "
+       "samples (default 512) and writes the result as WAV. --rt-check "
+       "fails the render if processBlock allocates, frees or locks a mutex. "
+       "--multi-core spreads the channel groups of wide files over the "
+       "worker pool.",
+       [](const juce::ArgumentList &args) { render(parseOptions(args)); }});
+
+  return app.findAndRunCommand(argc, argv);
+}
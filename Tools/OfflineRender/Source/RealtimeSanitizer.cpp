@@ -0,0 +1,141 @@
+#include "RealtimeSanitizer.h"
+
+#if JUCE_LINUX
+#include <cerrno>
+#include <dlfcn.h>
+#include <pthread.h>
+
+// glibc's own allocator entry points, used to forward the interposed calls
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+void __libc_free(void *ptr);
+}
+
+// STATE
+//==============================================================================
+// Everything here must be usable from inside malloc, so only constant
+// initialised atomics and thread locals
+static std::atomic<bool> sanitizerEnabled{false};
+static std::atomic<int> allocationCount{0};
+static std::atomic<int> deallocationCount{0};
+static std::atomic<int> lockCount{0};
+static thread_local bool isAudioThread = false;
+
+static bool shouldRecord() {
+  return isAudioThread && sanitizerEnabled.load(std::memory_order_relaxed);
+}
+
+static void recordAllocation() {
+  if (shouldRecord()) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+static void recordDeallocation() {
+  if (shouldRecord()) {
+    deallocationCount.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+static void recordLock() {
+  if (shouldRecord()) {
+    lockCount.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+// The real pthread functions, resolved lazily without a function static
+// whose initialisation guard could itself take a lock
+using MutexFunction = int (*)(pthread_mutex_t *);
+static std::atomic<MutexFunction> realMutexLock{nullptr};
+static std::atomic<MutexFunction> realMutexTryLock{nullptr};
+
+static MutexFunction resolveMutexFunction(std::atomic<MutexFunction> &cached,
+                                          const char *name) {
+  auto function = cached.load(std::memory_order_acquire);
+  if (function == nullptr) {
+    function = reinterpret_cast<MutexFunction>(dlsym(RTLD_NEXT, name));
+    cached.store(function, std::memory_order_release);
+  }
+  return function;
+}
+
+// INTERPOSED FUNCTIONS
+//==============================================================================
+extern "C" {
+void *malloc(size_t size) {
+  recordAllocation();
+  return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) {
+  recordAllocation();
+  return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+  recordAllocation();
+  return __libc_realloc(ptr, size);
+}
+
+void *aligned_alloc(size_t alignment, size_t size) {
+  recordAllocation();
+  return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void **result, size_t alignment, size_t size) {
+  recordAllocation();
+  *result = __libc_memalign(alignment, size);
+  return *result != nullptr ? 0 : ENOMEM;
+}
+
+void free(void *ptr) {
+  if (ptr != nullptr) {
+    recordDeallocation();
+  }
+  __libc_free(ptr);
+}
+
+int pthread_mutex_lock(pthread_mutex_t *mutex) {
+  recordLock();
+  return resolveMutexFunction(realMutexLock, "pthread_mutex_lock")(mutex);
+}
+
+int pthread_mutex_trylock(pthread_mutex_t *mutex) {
+  recordLock();
+  return resolveMutexFunction(realMutexTryLock, "pthread_mutex_trylock")(mutex);
+}
+}
+
+// SANITIZER
+//==============================================================================
+RealtimeSanitizer::ScopedAudioThread::ScopedAudioThread() {
+  isAudioThread = true;
+}
+
+RealtimeSanitizer::ScopedAudioThread::~ScopedAudioThread() {
+  isAudioThread = false;
+}
+
+bool RealtimeSanitizer::isSupported() { return true; }
+
+void RealtimeSanitizer::setEnabled(bool shouldBeEnabled) {
+  sanitizerEnabled.store(shouldBeEnabled);
+}
+
+RealtimeSanitizer::Violations RealtimeSanitizer::getViolations() {
+  return {allocationCount.load(), deallocationCount.load(), lockCount.load()};
+}
+
+#else
+
+RealtimeSanitizer::ScopedAudioThread::ScopedAudioThread() {}
+RealtimeSanitizer::ScopedAudioThread::~ScopedAudioThread() {}
+
+bool RealtimeSanitizer::isSupported() { return false; }
+void RealtimeSanitizer::setEnabled(bool) {}
+RealtimeSanitizer::Violations RealtimeSanitizer::getViolations() { return {}; }
+
+#endif
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// REALTIME SANITIZER
+//==============================================================================
+// Counts heap allocations, frees and mutex acquisitions made by a thread while
+// it is inside a ScopedAudioThread. Works by interposing malloc/free and
+// pthread_mutex_lock in the executable, so it is only available on Linux.
+struct RealtimeSanitizer {
+  struct Violations {
+    int allocations = 0;
+    int deallocations = 0;
+    int lockAcquisitions = 0;
+
+    int getTotal() const {
+      return allocations + deallocations + lockAcquisitions;
+    }
+  };
+
+  // Marks the current thread as an audio thread for the scope's lifetime
+  struct ScopedAudioThread {
+    ScopedAudioThread();
+    ~ScopedAudioThread();
+  };
+
+  static bool isSupported();
+  static void setEnabled(bool shouldBeEnabled);
+  static Violations getViolations();
+};